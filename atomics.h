@@ -0,0 +1,28 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef ATOMICSH
+
+#define ATOMICSH
+
+/* SDL 1.2 has no atomic operations, so we rely on the GCC builtins (MinGW included).
+   AtomicGet and AtomicSet are full barriers, which is all the ring buffers and the worker need. */
+#define AtomicGet(ptr)              __sync_add_and_fetch((ptr), 0)
+#define AtomicSet(ptr, value)       do { __sync_synchronize(); *(ptr) = (value); __sync_synchronize(); } while (0)
+#define AtomicAdd(ptr, value)       __sync_add_and_fetch((ptr), (value))
+#define AtomicCAS(ptr, old, new)    __sync_bool_compare_and_swap((ptr), (old), (new))
+
+#endif
@@ -0,0 +1,531 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <string.h>
+#include <math.h>
+#include "bands.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define BANDS_X86
+#include <immintrin.h>
+#endif
+
+typedef struct
+{
+    char description[10];
+    double (*Sum)(const DFTReal *data, unsigned int length);
+    void (*Magnitudes)(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins);
+    void (*Powers)(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins);
+    void (*Convert)(DFTReal *output, const void *pcmData, unsigned int length, int format, const DFTReal *window);
+} BandKernels;
+
+static double SumScalar(const DFTReal *data, unsigned int length);
+static void MagnitudesScalar(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins);
+static void PowersScalar(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins);
+static void ConvertScalar(DFTReal *output, const void *pcmData, unsigned int length, int format, const DFTReal *window);
+#ifdef BANDS_X86
+static double SumSSE2(const DFTReal *data, unsigned int length);
+static void MagnitudesSSE2(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins);
+static void PowersSSE2(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins);
+static double SumAVX2(const DFTReal *data, unsigned int length);
+static void MagnitudesAVX2(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins);
+static void PowersAVX2(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins);
+static void ConvertAVX2(DFTReal *output, const void *pcmData, unsigned int length, int format, const DFTReal *window);
+static double SumAVX512(const DFTReal *data, unsigned int length);
+static void MagnitudesAVX512(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins);
+static void PowersAVX512(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins);
+#endif
+
+/* Widening the 8 and 16 bits samples takes SSE4.1, the conversion only has a scalar and an AVX2 kernel */
+static BandKernels tabKernels[] =
+{
+    { "scalar", SumScalar, MagnitudesScalar, PowersScalar, ConvertScalar },
+#ifdef BANDS_X86
+    { "SSE2", SumSSE2, MagnitudesSSE2, PowersSSE2, ConvertScalar },
+    { "AVX2", SumAVX2, MagnitudesAVX2, PowersAVX2, ConvertAVX2 },
+    { "AVX-512", SumAVX512, MagnitudesAVX512, PowersAVX512, ConvertAVX2 },
+#endif
+};
+
+static const BandKernels *kernels = NULL;
+
+
+/* Takes the best kernels the processor supports, up to maxLevel (BANDS_xxx) */
+int SelectBandKernels(int maxLevel)
+{
+    int level = BANDS_SCALAR;
+
+#ifdef BANDS_X86
+    __builtin_cpu_init();
+    if (maxLevel >= BANDS_SSE2 && __builtin_cpu_supports("sse2"))
+        level = BANDS_SSE2;
+    if (maxLevel >= BANDS_AVX2 && __builtin_cpu_supports("avx2"))
+        level = BANDS_AVX2;
+    if (maxLevel >= BANDS_AVX512 && __builtin_cpu_supports("avx512f"))
+        level = BANDS_AVX512;
+#endif
+
+    kernels = &tabKernels[level];
+    return level;
+}
+
+const char* GetBandKernelsName(void)
+{
+    if (!kernels)
+        SelectBandKernels(BANDS_AVX512);
+    return kernels->description;
+}
+
+double SumBins(const DFTReal *data, unsigned int from, unsigned int to)
+{
+    if (!kernels)
+        SelectBandKernels(BANDS_AVX512);
+    return to > from ? kernels->Sum(data + from, to - from) : 0;
+}
+
+/* Mean magnitude in each band, for a transform of length samples */
+void GetBandPowers(const DFTReal *modules, unsigned int length, unsigned int samplingFreq, double bandPowers[4])
+{
+    unsigned int tabBands[] = {0, BAND1, BAND2, BAND3, BAND4},
+                 from, to, i;
+
+    for (i=0 ; i < 4 ; i++)
+    {
+        from = tabBands[i]*length/samplingFreq;
+        to = tabBands[i+1]*length/samplingFreq;
+        bandPowers[i] = to > from ? SumBins(modules, from, to) / (to - from) : 0;
+    }
+}
+
+void ComplexMagnitudes(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins)
+{
+    if (!kernels)
+        SelectBandKernels(BANDS_AVX512);
+    kernels->Magnitudes(complexData, modules, nbBins);
+}
+
+void ComplexPowers(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins)
+{
+    if (!kernels)
+        SelectBandKernels(BANDS_AVX512);
+    kernels->Powers(complexData, powers, nbBins);
+}
+
+/* Converts length samples to DFTReal, scaled to [-1,1] and multiplied by the window if there is one,
+   in a single pass: this is how the samples get into the transform buffers */
+void ConvertPCM(DFTReal *output, const void *pcmData, unsigned int length, int format, const DFTReal *window)
+{
+    if (!kernels)
+        SelectBandKernels(BANDS_AVX512);
+    kernels->Convert(output, pcmData, length, format, window);
+}
+
+
+static double SumScalar(const DFTReal *data, unsigned int length)
+{
+    unsigned int i;
+    double sum = 0;
+
+    for (i=0 ; i < length ; i++)
+        sum += data[i];
+
+    return sum;
+}
+
+static void MagnitudesScalar(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins)
+{
+    unsigned int i;
+
+    for (i=0 ; i < nbBins ; i++)
+        modules[i] = DFTSqrt(complexData[2*i]*complexData[2*i] + complexData[2*i+1]*complexData[2*i+1]);
+}
+
+static void PowersScalar(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins)
+{
+    unsigned int i;
+
+    for (i=0 ; i < nbBins ; i++)
+        powers[i] = complexData[2*i]*complexData[2*i] + complexData[2*i+1]*complexData[2*i+1];
+}
+
+static void ConvertScalar(DFTReal *output, const void *pcmData, unsigned int length, int format, const DFTReal *window)
+{
+    unsigned int i;
+    DFTReal value,
+            scale = GetPCMScale(format);
+
+    for (i=0 ; i < length ; i++)
+    {
+        if (format == PCM_FORMAT_PCM16)
+            value = ((const Sint16*)pcmData)[i] * scale;
+        else if (format == PCM_FORMAT_FLOAT)
+            value = ((const float*)pcmData)[i] * scale;
+        else value = ((const Sint8*)pcmData)[i] * scale;
+
+        output[i] = window ? value * window[i] : value;
+    }
+}
+
+#if defined(BANDS_X86) && !defined(DFT_FLOAT)
+
+/* SSE2: two bins at once, (re0,im0) and (re1,im1) are regrouped into (re0,re1) and (im0,im1) */
+__attribute__((target("sse2")))
+static double SumSSE2(const DFTReal *data, unsigned int length)
+{
+    unsigned int i;
+    __m128d sum1 = _mm_setzero_pd(),
+            sum2 = _mm_setzero_pd();
+    double result[2];
+
+    for (i=0 ; i+4 <= length ; i += 4)
+    {
+        sum1 = _mm_add_pd(sum1, _mm_loadu_pd(data + i));
+        sum2 = _mm_add_pd(sum2, _mm_loadu_pd(data + i + 2));
+    }
+    _mm_storeu_pd(result, _mm_add_pd(sum1, sum2));
+
+    return result[0] + result[1] + SumScalar(data + i, length - i);
+}
+
+__attribute__((target("sse2")))
+static void PowersSSE2(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins)
+{
+    unsigned int i;
+    __m128d a, b, re, im;
+
+    for (i=0 ; i+2 <= nbBins ; i += 2)
+    {
+        a = _mm_loadu_pd(complexData + 2*i);
+        b = _mm_loadu_pd(complexData + 2*i + 2);
+        re = _mm_unpacklo_pd(a, b);
+        im = _mm_unpackhi_pd(a, b);
+        _mm_storeu_pd(powers + i, _mm_add_pd(_mm_mul_pd(re, re), _mm_mul_pd(im, im)));
+    }
+
+    PowersScalar(complexData + 2*i, powers + i, nbBins - i);
+}
+
+__attribute__((target("sse2")))
+static void MagnitudesSSE2(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins)
+{
+    unsigned int i;
+
+    PowersSSE2(complexData, modules, nbBins);
+    for (i=0 ; i+2 <= nbBins ; i += 2)
+        _mm_storeu_pd(modules + i, _mm_sqrt_pd(_mm_loadu_pd(modules + i)));
+    for (; i < nbBins ; i++)
+        modules[i] = sqrt(modules[i]);
+}
+
+/* AVX2: four bins at once, the unpacks work inside 128 bits lanes so the result comes out as bins
+   0,2,1,3 and is put back in order with a permutation */
+__attribute__((target("avx2")))
+static double SumAVX2(const DFTReal *data, unsigned int length)
+{
+    unsigned int i;
+    __m256d sum1 = _mm256_setzero_pd(),
+            sum2 = _mm256_setzero_pd();
+    double result[4];
+
+    for (i=0 ; i+8 <= length ; i += 8)
+    {
+        sum1 = _mm256_add_pd(sum1, _mm256_loadu_pd(data + i));
+        sum2 = _mm256_add_pd(sum2, _mm256_loadu_pd(data + i + 4));
+    }
+    _mm256_storeu_pd(result, _mm256_add_pd(sum1, sum2));
+
+    return (result[0] + result[1]) + (result[2] + result[3]) + SumScalar(data + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static void PowersAVX2(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins)
+{
+    unsigned int i;
+    __m256d a, b, re, im;
+
+    for (i=0 ; i+4 <= nbBins ; i += 4)
+    {
+        a = _mm256_loadu_pd(complexData + 2*i);
+        b = _mm256_loadu_pd(complexData + 2*i + 4);
+        re = _mm256_unpacklo_pd(a, b);
+        im = _mm256_unpackhi_pd(a, b);
+        _mm256_storeu_pd(powers + i, _mm256_permute4x64_pd(_mm256_add_pd(_mm256_mul_pd(re, re), _mm256_mul_pd(im, im)), 0xD8));
+    }
+
+    PowersScalar(complexData + 2*i, powers + i, nbBins - i);
+}
+
+__attribute__((target("avx2")))
+static void MagnitudesAVX2(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins)
+{
+    unsigned int i;
+
+    PowersAVX2(complexData, modules, nbBins);
+    for (i=0 ; i+4 <= nbBins ; i += 4)
+        _mm256_storeu_pd(modules + i, _mm256_sqrt_pd(_mm256_loadu_pd(modules + i)));
+    for (; i < nbBins ; i++)
+        modules[i] = sqrt(modules[i]);
+}
+
+/* Four samples at once, widened to 32 bits integers (or taken as floats) and converted to doubles */
+__attribute__((target("avx2")))
+static void ConvertAVX2(DFTReal *output, const void *pcmData, unsigned int length, int format, const DFTReal *window)
+{
+    unsigned int i;
+    __m256d scale = _mm256_set1_pd(GetPCMScale(format)),
+            value;
+    int packed;
+
+    for (i=0 ; i+4 <= length ; i += 4)
+    {
+        if (format == PCM_FORMAT_PCM16)
+            value = _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*)((const Sint16*)pcmData + i))));
+        else if (format == PCM_FORMAT_FLOAT)
+            value = _mm256_cvtps_pd(_mm_loadu_ps((const float*)pcmData + i));
+        else
+        {
+            memcpy(&packed, (const Sint8*)pcmData + i, 4);
+            value = _mm256_cvtepi32_pd(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(packed)));
+        }
+
+        value = _mm256_mul_pd(value, scale);
+        if (window)
+            value = _mm256_mul_pd(value, _mm256_loadu_pd(window + i));
+        _mm256_storeu_pd(output + i, value);
+    }
+
+    ConvertScalar(output + i, (const Uint8*)pcmData + i*GetPCMSampleSize(format), length - i, format, window ? window + i : NULL);
+}
+
+/* AVX-512: eight bins at once, unpacked as bins 0,4,1,5,2,6,3,7 */
+__attribute__((target("avx512f")))
+static double SumAVX512(const DFTReal *data, unsigned int length)
+{
+    unsigned int i;
+    __m512d sum = _mm512_setzero_pd();
+
+    for (i=0 ; i+8 <= length ; i += 8)
+        sum = _mm512_add_pd(sum, _mm512_loadu_pd(data + i));
+
+    return _mm512_reduce_add_pd(sum) + SumScalar(data + i, length - i);
+}
+
+__attribute__((target("avx512f")))
+static void PowersAVX512(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins)
+{
+    unsigned int i;
+    __m512d a, b, re, im;
+    __m512i order = _mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0);
+
+    for (i=0 ; i+8 <= nbBins ; i += 8)
+    {
+        a = _mm512_loadu_pd(complexData + 2*i);
+        b = _mm512_loadu_pd(complexData + 2*i + 8);
+        re = _mm512_unpacklo_pd(a, b);
+        im = _mm512_unpackhi_pd(a, b);
+        _mm512_storeu_pd(powers + i, _mm512_permutexvar_pd(order, _mm512_add_pd(_mm512_mul_pd(re, re), _mm512_mul_pd(im, im))));
+    }
+
+    PowersScalar(complexData + 2*i, powers + i, nbBins - i);
+}
+
+__attribute__((target("avx512f")))
+static void MagnitudesAVX512(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins)
+{
+    unsigned int i;
+
+    PowersAVX512(complexData, modules, nbBins);
+    for (i=0 ; i+8 <= nbBins ; i += 8)
+        _mm512_storeu_pd(modules + i, _mm512_sqrt_pd(_mm512_loadu_pd(modules + i)));
+    for (; i < nbBins ; i++)
+        modules[i] = sqrt(modules[i]);
+}
+
+#elif defined(BANDS_X86)
+
+/* SSE: four bins at once, (re0,im0,re1,im1) and (re2,im2,re3,im3) are regrouped into (re0..re3) and
+   (im0..im3). The sums are made in float and only the total is converted. */
+__attribute__((target("sse2")))
+static double SumSSE2(const DFTReal *data, unsigned int length)
+{
+    unsigned int i;
+    __m128 sum1 = _mm_setzero_ps(),
+           sum2 = _mm_setzero_ps();
+    float result[4];
+
+    for (i=0 ; i+8 <= length ; i += 8)
+    {
+        sum1 = _mm_add_ps(sum1, _mm_loadu_ps(data + i));
+        sum2 = _mm_add_ps(sum2, _mm_loadu_ps(data + i + 4));
+    }
+    _mm_storeu_ps(result, _mm_add_ps(sum1, sum2));
+
+    return (double)(result[0] + result[1]) + (result[2] + result[3]) + SumScalar(data + i, length - i);
+}
+
+__attribute__((target("sse2")))
+static void PowersSSE2(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins)
+{
+    unsigned int i;
+    __m128 a, b, re, im;
+
+    for (i=0 ; i+4 <= nbBins ; i += 4)
+    {
+        a = _mm_loadu_ps(complexData + 2*i);
+        b = _mm_loadu_ps(complexData + 2*i + 4);
+        re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(powers + i, _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)));
+    }
+
+    PowersScalar(complexData + 2*i, powers + i, nbBins - i);
+}
+
+__attribute__((target("sse2")))
+static void MagnitudesSSE2(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins)
+{
+    unsigned int i;
+
+    PowersSSE2(complexData, modules, nbBins);
+    for (i=0 ; i+4 <= nbBins ; i += 4)
+        _mm_storeu_ps(modules + i, _mm_sqrt_ps(_mm_loadu_ps(modules + i)));
+    for (; i < nbBins ; i++)
+        modules[i] = DFTSqrt(modules[i]);
+}
+
+/* AVX2: eight bins at once, the shuffles work inside 128 bits lanes so the result comes out as pairs
+   of bins 0-1,4-5,2-3,6-7 and is put back in order with a permutation */
+__attribute__((target("avx2")))
+static double SumAVX2(const DFTReal *data, unsigned int length)
+{
+    unsigned int i;
+    __m256 sum1 = _mm256_setzero_ps(),
+           sum2 = _mm256_setzero_ps();
+    float result[8];
+
+    for (i=0 ; i+16 <= length ; i += 16)
+    {
+        sum1 = _mm256_add_ps(sum1, _mm256_loadu_ps(data + i));
+        sum2 = _mm256_add_ps(sum2, _mm256_loadu_ps(data + i + 8));
+    }
+    _mm256_storeu_ps(result, _mm256_add_ps(sum1, sum2));
+
+    return (double)((result[0] + result[1]) + (result[2] + result[3]))
+           + ((result[4] + result[5]) + (result[6] + result[7])) + SumScalar(data + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static void PowersAVX2(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins)
+{
+    unsigned int i;
+    __m256 a, b, re, im;
+
+    for (i=0 ; i+8 <= nbBins ; i += 8)
+    {
+        a = _mm256_loadu_ps(complexData + 2*i);
+        b = _mm256_loadu_ps(complexData + 2*i + 8);
+        re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm256_storeu_ps(powers + i, _mm256_castpd_ps(_mm256_permute4x64_pd(
+                         _mm256_castps_pd(_mm256_add_ps(_mm256_mul_ps(re, re), _mm256_mul_ps(im, im))), 0xD8)));
+    }
+
+    PowersScalar(complexData + 2*i, powers + i, nbBins - i);
+}
+
+__attribute__((target("avx2")))
+static void MagnitudesAVX2(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins)
+{
+    unsigned int i;
+
+    PowersAVX2(complexData, modules, nbBins);
+    for (i=0 ; i+8 <= nbBins ; i += 8)
+        _mm256_storeu_ps(modules + i, _mm256_sqrt_ps(_mm256_loadu_ps(modules + i)));
+    for (; i < nbBins ; i++)
+        modules[i] = DFTSqrt(modules[i]);
+}
+
+/* Eight samples at once, widened to 32 bits integers (or taken as they are) and converted to floats */
+__attribute__((target("avx2")))
+static void ConvertAVX2(DFTReal *output, const void *pcmData, unsigned int length, int format, const DFTReal *window)
+{
+    unsigned int i;
+    __m256 scale = _mm256_set1_ps(GetPCMScale(format)),
+           value;
+
+    for (i=0 ; i+8 <= length ; i += 8)
+    {
+        if (format == PCM_FORMAT_PCM16)
+            value = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)((const Sint16*)pcmData + i))));
+        else if (format == PCM_FORMAT_FLOAT)
+            value = _mm256_loadu_ps((const float*)pcmData + i);
+        else value = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)((const Sint8*)pcmData + i))));
+
+        value = _mm256_mul_ps(value, scale);
+        if (window)
+            value = _mm256_mul_ps(value, _mm256_loadu_ps(window + i));
+        _mm256_storeu_ps(output + i, value);
+    }
+
+    ConvertScalar(output + i, (const Uint8*)pcmData + i*GetPCMSampleSize(format), length - i, format, window ? window + i : NULL);
+}
+
+/* AVX-512: sixteen bins at once, as pairs 0-1,8-9,2-3,10-11,4-5,12-13,6-7,14-15 */
+__attribute__((target("avx512f")))
+static double SumAVX512(const DFTReal *data, unsigned int length)
+{
+    unsigned int i;
+    __m512 sum = _mm512_setzero_ps();
+
+    for (i=0 ; i+16 <= length ; i += 16)
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(data + i));
+
+    return _mm512_reduce_add_ps(sum) + SumScalar(data + i, length - i);
+}
+
+__attribute__((target("avx512f")))
+static void PowersAVX512(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins)
+{
+    unsigned int i;
+    __m512 a, b, re, im;
+    __m512i order = _mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0);
+
+    for (i=0 ; i+16 <= nbBins ; i += 16)
+    {
+        a = _mm512_loadu_ps(complexData + 2*i);
+        b = _mm512_loadu_ps(complexData + 2*i + 16);
+        re = _mm512_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        im = _mm512_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm512_storeu_ps(powers + i, _mm512_castpd_ps(_mm512_permutexvar_pd(order,
+                         _mm512_castps_pd(_mm512_add_ps(_mm512_mul_ps(re, re), _mm512_mul_ps(im, im))))));
+    }
+
+    PowersScalar(complexData + 2*i, powers + i, nbBins - i);
+}
+
+__attribute__((target("avx512f")))
+static void MagnitudesAVX512(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins)
+{
+    unsigned int i;
+
+    PowersAVX512(complexData, modules, nbBins);
+    for (i=0 ; i+16 <= nbBins ; i += 16)
+        _mm512_storeu_ps(modules + i, _mm512_sqrt_ps(_mm512_loadu_ps(modules + i)));
+    for (; i < nbBins ; i++)
+        modules[i] = DFTSqrt(modules[i]);
+}
+
+#endif
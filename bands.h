@@ -0,0 +1,53 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef BANDSH
+
+#define BANDSH
+
+#include "dft.h"
+#include "pcm.h"
+
+#define BAND1                   350
+#define BAND2                   1750
+#define BAND3                   3000
+#define BAND4                   5000
+
+#define BANDS_SCALAR            0
+#define BANDS_SSE2              1
+#define BANDS_AVX2              2
+#define BANDS_AVX512            3
+
+/* The vector kernels make the same products as the scalar one but add them in another order, so their
+   results are not bit for bit the same: they stay within BANDS_TOLERANCE of the scalar results,
+   relatively to the magnitude of what is summed. The benchmark mode checks it.
+   In single precision the vectors are twice as wide and the sums keep float accumulators. */
+#ifdef DFT_FLOAT
+#define BANDS_TOLERANCE         1e-5
+#else
+#define BANDS_TOLERANCE         1e-12
+#endif
+
+int SelectBandKernels(int maxLevel);
+const char* GetBandKernelsName(void);
+
+double SumBins(const DFTReal *data, unsigned int from, unsigned int to);
+void GetBandPowers(const DFTReal *modules, unsigned int length, unsigned int samplingFreq, double bandPowers[4]);
+void ComplexMagnitudes(const DFTReal *complexData, DFTReal *modules, unsigned int nbBins);
+void ComplexPowers(const DFTReal *complexData, DFTReal *powers, unsigned int nbBins);
+void ConvertPCM(DFTReal *output, const void *pcmData, unsigned int length, int format, const DFTReal *window);
+
+#endif
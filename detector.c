@@ -0,0 +1,472 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "detector.h"
+
+static int TestDetector(Detector *detector);
+static int RunCascade(Detector *detector);
+static int ClassifyFrames(Detector *detector);
+static int IsInTimeSpace(const Detector *detector);
+static void MarkDetection(Detector *detector);
+static int IsNoisySnapshot(Detector *detector, const DFTReal *modules, int isNoiseSubtracted);
+
+
+int InitDetector(Detector *detector, unsigned int samplingFreq, int format, unsigned int windowLength_PCM, unsigned int hopLength_PCM,
+                 unsigned int bufferLength_PCM, double threshold)
+{
+    memset(detector, 0, sizeof(Detector));
+    detector->samplingFreq = samplingFreq;
+    detector->threshold = threshold;
+    detector->cascadeRatio = DETECTOR_CASCADERATIO;
+
+    if (!InitSTFT(&detector->stft, samplingFreq, format, windowLength_PCM, hopLength_PCM, bufferLength_PCM))
+        return 0;
+    if (!InitFeatureExtractor(&detector->features, detector->stft.frameLength, samplingFreq))
+    {
+        FreeSTFT(&detector->stft);
+        return 0;
+    }
+
+    detector->nbBandBins = BAND4*detector->stft.frameLength/samplingFreq + 1;
+    detector->band3From = BAND2*detector->stft.frameLength/samplingFreq;
+    detector->band3To = BAND3*detector->stft.frameLength/samplingFreq;
+    SetSTFTActiveBins(&detector->stft, detector->nbBandBins);
+    return 1;
+}
+
+void FreeDetector(Detector *detector)
+{
+    FreeSTFT(&detector->stft);
+    FreeFeatureExtractor(&detector->features);
+    memset(detector, 0, sizeof(Detector));
+}
+
+/* The gate is off while the spectrum is displayed: a skipped frame has no spectrum to show */
+void SetDetectorFullSpectrum(Detector *detector, int isFullSpectrum)
+{
+    detector->stft.isGated = !isFullSpectrum;
+    SetSTFTActiveBins(&detector->stft, isFullSpectrum ? detector->stft.nbBins : detector->nbBandBins);
+}
+
+/* First stage of the cascade, on the frame given (which must still be in the window): its band 3 stands
+   out of the noise floor. A frame skipped by the gate stands as the noise floor, so it never passes. */
+int IsDetectorCandidate(Detector *detector, Uint32 frame)
+{
+    const STFT *stft = &detector->stft;
+    const DFTReal *powers = stft->history + (frame % stft->nbWindowFrames)*stft->nbBins;
+
+    return SumBins(powers, detector->band3From, detector->band3To)
+           > detector->cascadeRatio * SumBins(stft->noise.powers, detector->band3From, detector->band3To);
+}
+
+/* Second stage of the cascade: the full analysis of the window, whatever the first stage said */
+int TestDetectorWindow(Detector *detector)
+{
+    STFT *stft = &detector->stft;
+    int isNoiseReady = IsNoiseModelReady(&stft->noise);
+
+    GetSTFTSpectra(stft, isNoiseReady);
+    return IsNoisySnapshot(detector, stft->modules, isNoiseReady);
+}
+
+/* Features of the frame given (which must still be in the window), against the current noise floor.
+   The flux is taken from the noise floor for the first frame of the window. */
+void GetDetectorFeatures(Detector *detector, Uint32 frame, float features[FEATURES_SIZE])
+{
+    const STFT *stft = &detector->stft;
+    const DFTReal *powers = stft->history + (frame % stft->nbWindowFrames)*stft->nbBins,
+                  *previousPowers = stft->noise.powers;
+
+    if (frame > 0 && stft->nbFrames - (frame-1) <= stft->nbWindowFrames)
+        previousPowers = stft->history + ((frame-1) % stft->nbWindowFrames)*stft->nbBins;
+
+    ExtractFeatures(&detector->features, powers, previousPowers, stft->noise.powers, features);
+}
+
+int FeedDetector(Detector *detector, const void *pcmData, unsigned int length)
+{
+    detector->nbSamples += length;
+    return FeedSTFT(&detector->stft, pcmData, length);
+}
+
+int RunDetector(Detector *detector)
+{
+    if (!TestDetector(detector))
+        return 0;
+
+    MarkDetection(detector);
+    return 1;
+}
+
+/* One tick of the live analysis: the samples recorded since the last one (in two parts, as a ring gives
+   them) are fed, then the detection runs if a frame was completed. Returns the number of new frames. */
+int TickDetector(Detector *detector, const void *pcmData1, unsigned int length1, const void *pcmData2, unsigned int length2, int *isSnapshot)
+{
+    int nbNewFrames = FeedDetector(detector, pcmData1, length1) + FeedDetector(detector, pcmData2, length2);
+
+    *isSnapshot = nbNewFrames > 0 && RunDetector(detector);
+    return nbNewFrames;
+}
+
+/* Hop and tick (in ms) which keep the wait for a detection within latency_ms: a snap is in the first
+   frame which ends after it, at most a hop later, and that frame is analysed at the next tick. Processing
+   time is not counted. The standard profile (latency_ms 0) ticks every DETECTOR_TICKLENGTH ms on frames
+   which do not overlap (hop 0). */
+void GetDetectorProfile(unsigned int latency_ms, unsigned int *hopLength_ms, unsigned int *tickLength_ms)
+{
+    if (!latency_ms)
+    {
+        *hopLength_ms = 0;
+        *tickLength_ms = DETECTOR_TICKLENGTH;
+    }
+    else *hopLength_ms = *tickLength_ms = latency_ms/2 > STFT_MINHOP_MS ? latency_ms/2 : STFT_MINHOP_MS;
+}
+
+/* minVotes is taken as a majority of the channels if 0 */
+int InitMultiDetector(MultiDetector *multi, unsigned int nbChannels, unsigned int minVotes, unsigned int samplingFreq, int format,
+                      unsigned int windowLength_PCM, unsigned int hopLength_PCM, unsigned int bufferLength_PCM, double threshold)
+{
+    unsigned int c;
+
+    memset(multi, 0, sizeof(MultiDetector));
+    if (nbChannels < 1)
+        return 0;
+
+    multi->nbChannels = nbChannels;
+    multi->minVotes = minVotes > 0 && minVotes <= nbChannels ? minVotes : nbChannels/2 + 1;
+    multi->threshold = threshold;
+    multi->frameSize = GetPCMSampleSize(format) * nbChannels;
+
+    if ( !(multi->channels = calloc(nbChannels, sizeof(Detector)))
+        || !(multi->framePowers = calloc(nbChannels, sizeof(DFTReal*))) )
+    {
+        FreeMultiDetector(multi);
+        return 0;
+    }
+
+    for (c=0 ; c < nbChannels ; c++)
+    {
+        if (!InitDetector(&multi->channels[c], samplingFreq, format, windowLength_PCM, hopLength_PCM, bufferLength_PCM, threshold))
+        {
+            FreeMultiDetector(multi);
+            return 0;
+        }
+    }
+
+    if ( !(multi->frameData = malloc(multi->channels[0].stft.frameLength * multi->frameSize)) )
+    {
+        FreeMultiDetector(multi);
+        return 0;
+    }
+
+    /* The batch plan is made now rather than on the first frame */
+    ReleaseDFTPlan(AcquireDFTBatchPlan(multi->channels[0].stft.frameLength, nbChannels));
+
+    return 1;
+}
+
+void FreeMultiDetector(MultiDetector *multi)
+{
+    unsigned int c;
+
+    if (multi->channels)
+    {
+        for (c=0 ; c < multi->nbChannels ; c++)
+            FreeDetector(&multi->channels[c]);
+    }
+
+    free(multi->channels);
+    free(multi->frameData);
+    free(multi->framePowers);
+    memset(multi, 0, sizeof(MultiDetector));
+}
+
+void SetMultiDetectorFullSpectrum(MultiDetector *multi, int isFullSpectrum)
+{
+    unsigned int c;
+
+    for (c=0 ; c < multi->nbChannels ; c++)
+        SetDetectorFullSpectrum(&multi->channels[c], isFullSpectrum);
+}
+
+void SetMultiDetectorGate(MultiDetector *multi, int isGated)
+{
+    unsigned int c;
+
+    for (c=0 ; c < multi->nbChannels ; c++)
+        multi->channels[c].stft.isGated = isGated;
+}
+
+void SetMultiDetectorCascade(MultiDetector *multi, double cascadeRatio)
+{
+    unsigned int c;
+
+    for (c=0 ; c < multi->nbChannels ; c++)
+        multi->channels[c].cascadeRatio = cascadeRatio;
+}
+
+void SetMultiDetectorClassifier(MultiDetector *multi, int isClassified)
+{
+    unsigned int c;
+
+    for (c=0 ; c < multi->nbChannels ; c++)
+        multi->channels[c].isClassified = isClassified;
+}
+
+/* Sum over all the channels */
+void GetMultiDetectorCascade(const MultiDetector *multi, CascadeStats *cascade)
+{
+    unsigned int c;
+
+    memset(cascade, 0, sizeof(CascadeStats));
+    for (c=0 ; c < multi->nbChannels ; c++)
+    {
+        cascade->nbHops += multi->channels[c].cascade.nbHops;
+        cascade->nbCandidates += multi->channels[c].cascade.nbCandidates;
+        cascade->nbTicks += multi->channels[c].cascade.nbTicks;
+        cascade->nbFullTests += multi->channels[c].cascade.nbFullTests;
+    }
+}
+
+/* Same framing and gating as FeedSTFT, on frames of all the channels */
+int FeedMultiDetector(MultiDetector *multi, const void *pcmData, unsigned int length)
+{
+    STFT *stft = &multi->channels[0].stft;
+    DFTPlan *dftPlan = NULL;
+    const Uint8 *data = pcmData,
+                *frame;
+    unsigned int n, c, nbSkipped;
+    int nbNewFrames = 0, gateState;
+
+    multi->nbSamples += length;
+    for (c=0 ; c < multi->nbChannels ; c++)
+        multi->channels[c].nbSamples += length;
+
+    while (length > 0)
+    {
+        n = stft->frameLength - multi->framePos;
+        if (n > length)
+            n = length;
+
+        if (multi->framePos == 0 && n == stft->frameLength)
+            frame = data;
+        else
+        {
+            memcpy(multi->frameData + multi->framePos*multi->frameSize, data, n*multi->frameSize);
+            frame = multi->frameData;
+        }
+        multi->framePos += n;
+        data += n*multi->frameSize;
+        length -= n;
+
+        if (multi->framePos == stft->frameLength)
+        {
+            /* The gate of the first channel listens to all of them */
+            gateState = UpdateTransientGate(&stft->gate, frame, stft->frameLength, stft->format, multi->nbChannels);
+            for (c=0, nbSkipped=0 ; c < multi->nbChannels ; c++)
+                nbSkipped += IsSTFTFrameSkipped(&multi->channels[c].stft, gateState);
+
+            if (nbSkipped == multi->nbChannels)
+            {
+                for (c=0 ; c < multi->nbChannels ; c++)
+                    SkipSTFTFrame(&multi->channels[c].stft);
+            }
+            else
+            {
+                if (!dftPlan && !(dftPlan = AcquireDFTBatchPlan(stft->frameLength, multi->nbChannels)))
+                    return nbNewFrames;
+
+                for (c=0 ; c < multi->nbChannels ; c++)
+                    multi->framePowers[c] = NextSTFTFrame(&multi->channels[c].stft);
+                ProcessDFTBatchPower(dftPlan, frame, stft->frameLength, stft->format, multi->framePowers, stft->nbActiveBins);
+                for (c=0 ; c < multi->nbChannels ; c++)
+                    CommitSTFTFrame(&multi->channels[c].stft);
+            }
+
+            multi->framePos = ShiftSTFTFrame(stft, multi->frameData, frame, multi->frameSize);
+            nbNewFrames++;
+        }
+    }
+
+    ReleaseDFTPlan(dftPlan);
+    return nbNewFrames;
+}
+
+/* Every channel is marked when the vote passes, so that they all wait TIMESPACEMIN together */
+int RunMultiDetector(MultiDetector *multi)
+{
+    unsigned int c, loudest = 0, nbVotes = 0;
+    double power3 = -1;
+
+    for (c=0 ; c < multi->nbChannels ; c++)
+    {
+        multi->channels[c].threshold = multi->threshold;
+        if (TestDetector(&multi->channels[c]))
+        {
+            nbVotes++;
+            if (multi->channels[c].bandPowers[2] > power3)
+            {
+                power3 = multi->channels[c].bandPowers[2];
+                loudest = c;
+                memcpy(multi->bandPowers, multi->channels[c].bandPowers, sizeof(multi->bandPowers));
+            }
+        }
+    }
+
+    if (nbVotes < multi->minVotes)
+        return 0;
+
+    for (c=0 ; c < multi->nbChannels ; c++)
+        MarkDetection(&multi->channels[c]);
+    multi->lastOnset = multi->channels[loudest].lastOnset;
+    multi->nbDetections++;
+    return 1;
+}
+
+static int TestDetector(Detector *detector)
+{
+    STFT *stft = &detector->stft;
+
+    detector->cascade.nbTicks++;
+    if (!stft->nbFrames || IsSTFTWindowQuiet(stft))
+    {
+        detector->cascade.nbHops += stft->nbFrames - detector->lastTestedFrame;
+        detector->lastTestedFrame = stft->nbFrames;
+        return 0;
+    }
+
+    if (detector->isClassified && IsNoiseModelReady(&stft->noise))
+        return ClassifyFrames(detector);
+
+    if (!RunCascade(detector))
+        return 0;
+
+    detector->cascade.nbFullTests++;
+    return TestDetectorWindow(detector);
+}
+
+/* Runs the first stage on the frames added since the last tick (those still in the window), and tells
+   whether a candidate is left in the window */
+static int RunCascade(Detector *detector)
+{
+    STFT *stft = &detector->stft;
+    Uint32 frame = detector->lastTestedFrame;
+
+    if (stft->nbFrames - frame > stft->nbWindowFrames)
+        frame = stft->nbFrames - stft->nbWindowFrames;
+    detector->cascade.nbHops += stft->nbFrames - detector->lastTestedFrame;
+    detector->lastTestedFrame = stft->nbFrames;
+
+    if (detector->cascadeRatio <= 0 || !stft->isGated || !IsNoiseModelReady(&stft->noise))
+        return 1;
+
+    for ( ; frame < stft->nbFrames ; frame++)
+    {
+        if (IsDetectorCandidate(detector, frame))
+        {
+            detector->hasCandidate = 1;
+            detector->candidateFrame = frame;
+            detector->cascade.nbCandidates++;
+        }
+    }
+
+    return detector->hasCandidate && stft->nbFrames - detector->candidateFrame <= stft->nbWindowFrames;
+}
+
+/* The band powers of a detection are still those of the window */
+static int ClassifyFrames(Detector *detector)
+{
+    STFT *stft = &detector->stft;
+    Uint32 frame = detector->lastTestedFrame;
+    float features[FEATURES_SIZE];
+    int isSnapshot = 0, isScored = 0;
+
+    if (stft->nbFrames - frame > stft->nbWindowFrames)
+        frame = stft->nbFrames - stft->nbWindowFrames;
+    detector->cascade.nbHops += stft->nbFrames - detector->lastTestedFrame;
+    detector->lastTestedFrame = stft->nbFrames;
+
+    for ( ; frame < stft->nbFrames && !isSnapshot ; frame++)
+    {
+        if (detector->cascadeRatio > 0 && !IsDetectorCandidate(detector, frame))
+            continue;
+
+        detector->cascade.nbCandidates++;
+        isScored = 1;
+        GetDetectorFeatures(detector, frame, features);
+        isSnapshot = ScoreFeatures(features) > 0;
+    }
+    detector->cascade.nbFullTests += isScored;
+
+    if (!isSnapshot || IsInTimeSpace(detector))
+        return 0;
+
+    GetSTFTSpectra(stft, 1);
+    GetBandPowers(stft->modules, stft->frameLength, detector->samplingFreq, detector->bandPowers);
+    return 1;
+}
+
+/* Too close to the last detection for another one. While the window still holds the frames of the last
+   detection (with windows longer than TIMESPACEMIN), only a snap with an onset after its own is a new one:
+   the frames already detected would pass the full analysis again at every tick. */
+static int IsInTimeSpace(const Detector *detector)
+{
+    const STFT *stft = &detector->stft;
+    Uint32 elapsed = detector->nbSamples - detector->lastDetection;
+
+    if (!detector->hasDetected)
+        return 0;
+    else if (elapsed < TIMESPACEMIN*detector->samplingFreq/1000)
+        return 1;
+    else return elapsed < stft->nbWindowFrames*stft->hopLength
+                && !(stft->lastOpenFrame > 0 && stft->onsetFrame*stft->hopLength > detector->lastOnset);
+}
+
+/* The candidate of the snap is dropped along with the window, so that it does not keep the full analysis
+   running at every tick */
+static void MarkDetection(Detector *detector)
+{
+    ExcludeSTFTWindow(&detector->stft);
+    detector->hasCandidate = 0;
+    detector->hasDetected = 1;
+    detector->lastOnset = GetSTFTOnset(&detector->stft);
+    detector->lastDetection = detector->nbSamples;
+    detector->nbDetections++;
+}
+
+/* Without a noise estimate yet, fall back on the plain band ratios of IsSnapshot */
+static int IsNoisySnapshot(Detector *detector, const DFTReal *modules, int isNoiseSubtracted)
+{
+    double power2, power3, power4,
+           threshold = detector->threshold;
+
+    GetBandPowers(modules, detector->stft.frameLength, detector->samplingFreq, detector->bandPowers);
+    power2 = detector->bandPowers[1];
+    power3 = detector->bandPowers[2];
+    power4 = detector->bandPowers[3];
+
+    if (IsInTimeSpace(detector))
+        return 0;
+
+    if (!isNoiseSubtracted)
+        return power3 > 0.5*power4 && power3 > 2*power2;
+
+    return power3 > threshold
+           && power3 > threshold*4*power2
+           && power3 > threshold*8*power4;
+}
@@ -0,0 +1,123 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef DETECTORH
+
+#define DETECTORH
+
+#include <SDL.h>
+#include "bands.h"
+#include "stft.h"
+#include "features.h"
+
+#define TIMESPACEMIN            300
+#define DETECTOR_TICKLENGTH     100
+#define DETECTOR_CASCADERATIO   2.0
+
+/* How far the detection went: out of nbHops new frames, nbCandidates passed the first stage of the
+   cascade (those of a quiet window are not even checked), and out of nbTicks ticks, nbFullTests ran
+   the full analysis of the window */
+typedef struct
+{
+    Uint32 nbHops,
+           nbCandidates,
+           nbTicks,
+           nbFullTests;
+} CascadeStats;
+
+/* Snap detection over a stream of PCM samples, in any of the PCM_FORMAT_xxx formats.
+   Samples are fed as they come (FeedDetector) and the detection runs on the current analysis window
+   (RunDetector), at whatever cadence the caller wants. Times are counted in samples fed, so the same
+   stream always gives the same decisions, whether it is live or read from a file.
+   lastOnset is where the snap of the last detection started, lastDetection where it was detected.
+   Only the bins up to BAND4 are computed, unless the full spectrum is asked for (to display it).
+   The detection is a cascade: each new frame is first checked alone, by the power of its band 3 against
+   that of the noise floor (IsDetectorCandidate). Only while a frame which passes is in the window does
+   a tick run the full analysis of the window, and a detection drops the candidate along with the
+   window. The cascade is off (every tick runs the full analysis) while the gate is, before the noise
+   model is ready, and with a cascadeRatio of 0.
+   With isClassified, the second stage is the learned classifier instead (ScoreFeatures): each candidate
+   frame is scored alone, once, and a snap is detected as soon as one scores above 0. A cascadeRatio of 0
+   scores every frame. The band inequalities are kept until the noise model is ready. */
+typedef struct
+{
+    STFT stft;
+    unsigned int samplingFreq,
+                 nbBandBins,
+                 band3From,
+                 band3To;
+    double threshold,
+           cascadeRatio;
+    Uint32 nbSamples,
+           lastOnset,
+           lastDetection,
+           nbDetections,
+           lastTestedFrame,
+           candidateFrame;
+    int hasDetected,
+        hasCandidate,
+        isClassified;
+    double bandPowers[4];
+    CascadeStats cascade;
+    FeatureExtractor features;
+} Detector;
+
+/* Fused detection over nbChannels interleaved channels (several microphones, or a multichannel file).
+   The frames are cut once for all channels and transformed in one batch, each channel keeps its own
+   STFT and noise model. A snap is detected when at least minVotes channels see one, so that a noise
+   right next to one microphone does not trigger anything. bandPowers and lastOnset are those of the
+   loudest voter. */
+typedef struct
+{
+    Detector *channels;
+    unsigned int nbChannels,
+                 minVotes,
+                 frameSize,
+                 framePos;
+    Uint8 *frameData;
+    DFTReal **framePowers;
+    double threshold;
+    Uint32 nbSamples,
+           lastOnset,
+           nbDetections;
+    double bandPowers[4];
+} MultiDetector;
+
+int InitDetector(Detector *detector, unsigned int samplingFreq, int format, unsigned int windowLength_PCM, unsigned int hopLength_PCM,
+                 unsigned int bufferLength_PCM, double threshold);
+void FreeDetector(Detector *detector);
+void SetDetectorFullSpectrum(Detector *detector, int isFullSpectrum);
+int IsDetectorCandidate(Detector *detector, Uint32 frame);
+int TestDetectorWindow(Detector *detector);
+void GetDetectorFeatures(Detector *detector, Uint32 frame, float features[FEATURES_SIZE]);
+int FeedDetector(Detector *detector, const void *pcmData, unsigned int length);
+int RunDetector(Detector *detector);
+int TickDetector(Detector *detector, const void *pcmData1, unsigned int length1, const void *pcmData2, unsigned int length2, int *isSnapshot);
+
+void GetDetectorProfile(unsigned int latency_ms, unsigned int *hopLength_ms, unsigned int *tickLength_ms);
+
+int InitMultiDetector(MultiDetector *multi, unsigned int nbChannels, unsigned int minVotes, unsigned int samplingFreq, int format,
+                      unsigned int windowLength_PCM, unsigned int hopLength_PCM, unsigned int bufferLength_PCM, double threshold);
+void FreeMultiDetector(MultiDetector *multi);
+void SetMultiDetectorFullSpectrum(MultiDetector *multi, int isFullSpectrum);
+void SetMultiDetectorGate(MultiDetector *multi, int isGated);
+void SetMultiDetectorCascade(MultiDetector *multi, double cascadeRatio);
+void SetMultiDetectorClassifier(MultiDetector *multi, int isClassified);
+void GetMultiDetectorCascade(const MultiDetector *multi, CascadeStats *cascade);
+int FeedMultiDetector(MultiDetector *multi, const void *pcmData, unsigned int length);
+int RunMultiDetector(MultiDetector *multi);
+
+#endif
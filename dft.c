@@ -0,0 +1,377 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "bands.h"
+#include "dft.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#ifdef DFT_FIXED
+#define DFTMalloc               malloc
+#define DFTFree                 free
+#else
+#define DFTMalloc               DFTW(malloc)
+#define DFTFree                 DFTW(free)
+#endif
+
+static DFTPlan tabPlans[DFT_MAXPLANS];
+static SDL_mutex *cacheMutex = NULL;
+static unsigned int useCounter = 0;
+
+static void FreeDFTPlan(DFTPlan *dftPlan);
+#ifndef DFT_FIXED
+static int IsSmoothLength(unsigned int length);
+#endif
+static DFTReal* CreateDFTWindow(unsigned int length, unsigned int nbChannels);
+#ifndef DFT_FIXED
+static void ExecuteDFT(DFTPlan *dftPlan, const void *pcmData, unsigned int pcmLength, int format);
+#endif
+static void ExecuteGoertzel(DFTPlan *dftPlan, const void *pcmData, unsigned int pcmLength, int format, DFTReal *powers[], unsigned int nbBins);
+
+
+int InitDFT(const char wisdomFileName[])
+{
+    if (!cacheMutex)
+    {
+        memset(tabPlans, 0, sizeof(tabPlans));
+        cacheMutex = SDL_CreateMutex();
+    }
+
+#ifdef DFT_FIXED
+    return 0;
+#else
+    if (wisdomFileName && DFTW(import_wisdom_from_filename)(wisdomFileName))
+        return 1;
+    else return 0;
+#endif
+}
+
+void QuitDFT(const char wisdomFileName[])
+{
+    int i;
+
+    if (!cacheMutex)
+        return;
+
+    if (wisdomFileName)
+        SaveDFTWisdom(wisdomFileName);
+
+    for (i=0 ; i < DFT_MAXPLANS ; i++)
+        FreeDFTPlan(&tabPlans[i]);
+
+    SDL_DestroyMutex(cacheMutex);
+    cacheMutex = NULL;
+}
+
+int SaveDFTWisdom(const char wisdomFileName[])
+{
+    int result = 0;
+
+#ifndef DFT_FIXED
+    SDL_mutexP(cacheMutex);
+    result = wisdomFileName && DFTW(export_wisdom_to_filename)(wisdomFileName);
+    SDL_mutexV(cacheMutex);
+#endif
+
+    return result;
+}
+
+DFTPlan* AcquireDFTPlan(unsigned int length)
+{
+    return AcquireDFTBatchPlan(length, 1);
+}
+
+DFTPlan* AcquireDFTBatchPlan(unsigned int length, unsigned int nbChannels)
+{
+    DFTPlan *dftPlan = NULL, *busyPlan = NULL;
+    int i;
+#ifndef DFT_FIXED
+    int n = length;
+#endif
+
+    SDL_mutexP(cacheMutex);
+
+    /* Several threads may transform the same length at once: each gets its own plan and buffers
+       as long as there is room in the cache, else they share (and wait for) a busy one */
+    for (i=0 ; i < DFT_MAXPLANS && !dftPlan ; i++)
+    {
+        if (tabPlans[i].length == length && tabPlans[i].nbChannels == nbChannels)
+        {
+            if (!tabPlans[i].nbUsers)
+                dftPlan = &tabPlans[i];
+            else if (!busyPlan || tabPlans[i].nbUsers < busyPlan->nbUsers)
+                busyPlan = &tabPlans[i];
+        }
+    }
+
+    if (!dftPlan)
+    {
+        /* Take a free slot, or else the least recently used plan which is not in use */
+        for (i=0 ; i < DFT_MAXPLANS ; i++)
+        {
+            if (!tabPlans[i].length)
+            {
+                dftPlan = &tabPlans[i];
+                break;
+            }
+            else if (!tabPlans[i].nbUsers && (!dftPlan || tabPlans[i].lastUse < dftPlan->lastUse))
+                dftPlan = &tabPlans[i];
+        }
+
+        if (dftPlan)
+        {
+            FreeDFTPlan(dftPlan);
+            dftPlan->dataIn = (DFTReal*) DFTMalloc(sizeof(DFTReal) * length * nbChannels);
+            dftPlan->modules = (DFTReal*) DFTMalloc(sizeof(DFTReal) * (length/2+1) * nbChannels);
+            dftPlan->window = CreateDFTWindow(length, nbChannels);
+#ifdef DFT_FIXED
+            InitFixedFFT(&dftPlan->fft, length);
+#else
+            dftPlan->dataOut = (DFTW(complex)*) DFTW(malloc)(sizeof(DFTW(complex)) * (length/2+1) * nbChannels);
+            if (nbChannels == 1)
+                dftPlan->plan = DFTW(plan_dft_r2c_1d)(length, dftPlan->dataIn, dftPlan->dataOut, DFT_PLANNER_FLAGS);
+            else dftPlan->plan = DFTW(plan_many_dft_r2c)(1, &n, nbChannels, dftPlan->dataIn, NULL, nbChannels, 1,
+                                                         dftPlan->dataOut, NULL, 1, length/2+1, DFT_PLANNER_FLAGS);
+#endif
+            dftPlan->mutex = SDL_CreateMutex();
+            dftPlan->length = length;
+            dftPlan->nbChannels = nbChannels;
+        }
+        else if (busyPlan)
+            dftPlan = busyPlan;
+        else
+        {
+            SDL_mutexV(cacheMutex);
+            return NULL;
+        }
+    }
+
+    dftPlan->lastUse = ++useCounter;
+    dftPlan->nbUsers++;
+    SDL_mutexV(cacheMutex);
+
+    SDL_mutexP(dftPlan->mutex);
+    return dftPlan;
+}
+
+void ReleaseDFTPlan(DFTPlan *dftPlan)
+{
+    if (!dftPlan)
+        return;
+
+    SDL_mutexV(dftPlan->mutex);
+    SDL_mutexP(cacheMutex);
+    dftPlan->nbUsers--;
+    SDL_mutexV(cacheMutex);
+}
+
+DFTReal* ProcessDFT(DFTPlan *dftPlan, const void *pcmData, unsigned int pcmLength, int format, DFTReal *modules)
+{
+#ifdef DFT_FIXED
+    unsigned int i;
+#endif
+
+    if (!modules)
+        modules = dftPlan->modules;
+
+#ifdef DFT_FIXED
+    ProcessDFTPower(dftPlan, pcmData, pcmLength, format, modules, 0);
+    for (i=0 ; i < dftPlan->length/2+1 ; i++)
+        modules[i] = DFTSqrt(modules[i]);
+#else
+    ExecuteDFT(dftPlan, pcmData, pcmLength, format);
+    ComplexMagnitudes((const DFTReal*)dftPlan->dataOut, modules, dftPlan->length/2+1);
+#endif
+
+    return modules;
+}
+
+/* Squared magnitudes of the first nbBins bins (all of them if nbBins is 0) */
+DFTReal* ProcessDFTPower(DFTPlan *dftPlan, const void *pcmData, unsigned int pcmLength, int format, DFTReal *powers, unsigned int nbBins)
+{
+    if (!powers)
+        powers = dftPlan->modules;
+
+    ProcessDFTBatchPower(dftPlan, pcmData, pcmLength, format, &powers, nbBins);
+    return powers;
+}
+
+/* Same for the pcmLength interleaved frames of a batch plan, channel c going to powers[c] */
+void ProcessDFTBatchPower(DFTPlan *dftPlan, const void *pcmData, unsigned int pcmLength, int format, DFTReal *powers[], unsigned int nbBins)
+{
+    unsigned int c, nbAllBins = dftPlan->length/2+1;
+
+    if (!nbBins || nbBins > nbAllBins)
+        nbBins = nbAllBins;
+
+#ifdef DFT_FIXED
+    if (IsGoertzelCheaper(dftPlan->length, pcmLength, nbBins) || !dftPlan->fft.length)
+#else
+    if (IsGoertzelCheaper(dftPlan->length, pcmLength, nbBins))
+#endif
+    {
+        ExecuteGoertzel(dftPlan, pcmData, pcmLength, format, powers, nbBins);
+        return;
+    }
+
+#ifdef DFT_FIXED
+    for (c=0 ; c < dftPlan->nbChannels ; c++)
+        ProcessFixedFFTPower(&dftPlan->fft, pcmData, pcmLength, format, c, dftPlan->nbChannels, powers[c], nbBins);
+#else
+    ExecuteDFT(dftPlan, pcmData, pcmLength, format);
+    for (c=0 ; c < dftPlan->nbChannels ; c++)
+        ComplexPowers((const DFTReal*)(dftPlan->dataOut + c*nbAllBins), powers[c], nbBins);
+#endif
+}
+
+int IsGoertzelCheaper(unsigned int length, unsigned int pcmLength, unsigned int nbBins)
+{
+    if (pcmLength > length)
+        pcmLength = length;
+
+    return (double)nbBins * pcmLength * DFT_GOERTZEL_COST < length * log2(length);
+}
+
+/* Length the transform is fast for, near length: the nearest product of 2, 3, 5 and 7 for FFTW (a large
+   prime factor makes it several times slower), the next power of two for the Q15 transform (the nearest
+   could drop a third of the samples). Given more samples than its length, a transform only takes the
+   first ones; given fewer, it pads them with zeros. */
+unsigned int GetDFTLength(unsigned int length)
+{
+    unsigned int above;
+#ifndef DFT_FIXED
+    unsigned int below;
+#endif
+
+    if (length < 2)
+        return 1;
+
+#ifdef DFT_FIXED
+    for (above=1 ; above < length ; above *= 2);
+    return above;
+#else
+    for (below=length ; !IsSmoothLength(below) ; below--);
+    if (below == length)
+        return length;
+    for (above=length+1 ; !IsSmoothLength(above) ; above++);
+
+    return above - length <= length - below ? above : below;
+#endif
+}
+
+/* Without DFT_WINDOW_HANN the window is rectangular (NULL). It is interleaved like the samples. */
+static DFTReal* CreateDFTWindow(unsigned int length, unsigned int nbChannels)
+{
+#ifdef DFT_WINDOW_HANN
+    unsigned int i;
+    DFTReal *window = NULL;
+
+    if ( !(window = (DFTReal*) DFTMalloc(sizeof(DFTReal) * length * nbChannels)) )
+        return NULL;
+
+    /* The mean square of a Hann window is 3/8 */
+    for (i=0 ; i < length*nbChannels ; i++)
+        window[i] = sqrt(8/3.0) * 0.5 * (1 - cos(2*M_PI*(i/nbChannels)/length));
+
+    return window;
+#else
+    return NULL;
+#endif
+}
+
+#ifndef DFT_FIXED
+/* The samples are converted, scaled and windowed straight into the input of the transform */
+static void ExecuteDFT(DFTPlan *dftPlan, const void *pcmData, unsigned int pcmLength, int format)
+{
+    unsigned int length = dftPlan->length,
+                 nbChannels = dftPlan->nbChannels;
+
+    if (pcmLength > length)
+        pcmLength = length;
+
+    ConvertPCM(dftPlan->dataIn, pcmData, pcmLength*nbChannels, format, dftPlan->window);
+    memset(dftPlan->dataIn + pcmLength*nbChannels, 0, sizeof(DFTReal) * (length - pcmLength) * nbChannels);
+    DFTW(execute)(dftPlan->plan);
+}
+#endif
+
+/* Zero padding up to the transform length changes the phase of a Goertzel output, not its magnitude,
+   so the filters only have to run over the pcmLength real samples */
+static void ExecuteGoertzel(DFTPlan *dftPlan, const void *pcmData, unsigned int pcmLength, int format, DFTReal *powers[], unsigned int nbBins)
+{
+    unsigned int i, k, c,
+                 nbChannels = dftPlan->nbChannels;
+    double coeff, s0, s1, s2;
+    DFTReal *data = dftPlan->dataIn;
+
+    if (pcmLength > dftPlan->length)
+        pcmLength = dftPlan->length;
+
+    ConvertPCM(data, pcmData, pcmLength*nbChannels, format, dftPlan->window);
+
+    for (k=0 ; k < nbBins ; k++)
+    {
+        coeff = 2*cos(2*M_PI*k/dftPlan->length);
+        for (c=0 ; c < nbChannels ; c++)
+        {
+            s1 = s2 = 0;
+            for (i=c ; i < pcmLength*nbChannels ; i += nbChannels)
+            {
+                s0 = data[i] + coeff*s1 - s2;
+                s2 = s1;
+                s1 = s0;
+            }
+
+            powers[c][k] = s1*s1 + s2*s2 - coeff*s1*s2;
+            if (powers[c][k] < 0)
+                powers[c][k] = 0;
+        }
+    }
+}
+
+static void FreeDFTPlan(DFTPlan *dftPlan)
+{
+    if (!dftPlan->length)
+        return;
+
+#ifdef DFT_FIXED
+    FreeFixedFFT(&dftPlan->fft);
+#else
+    DFTW(destroy_plan)(dftPlan->plan);
+    DFTW(free)(dftPlan->dataOut);
+#endif
+    DFTFree(dftPlan->dataIn);
+    DFTFree(dftPlan->modules);
+    DFTFree(dftPlan->window);
+    SDL_DestroyMutex(dftPlan->mutex);
+    memset(dftPlan, 0, sizeof(DFTPlan));
+}
+
+#ifndef DFT_FIXED
+static int IsSmoothLength(unsigned int length)
+{
+    for ( ; length % 2 == 0 ; length /= 2);
+    for ( ; length % 3 == 0 ; length /= 3);
+    for ( ; length % 5 == 0 ; length /= 5);
+    for ( ; length % 7 == 0 ; length /= 7);
+    return length == 1;
+}
+#endif
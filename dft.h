@@ -0,0 +1,105 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef DFTH
+
+#define DFTH
+
+#include <SDL.h>
+
+/* Build with DFT_FLOAT (and link with fftw3f) to run the whole analysis in single precision: even
+   16 bits samples do not need more, float spectra take half the memory and bandwidth.
+   Build with DFT_FIXED to transform in Q15 fixed point (fixed.h) without FFTW at all, for machines
+   with a weak FPU: the spectra are in single precision, there are no plans to save (no wisdom file).
+   Only powers of two are transformed so, the other lengths (the whole-window transform of the old
+   detection) go through the Goertzel filters. */
+#ifdef DFT_FIXED
+#include "fixed.h"
+#ifndef DFT_FLOAT
+#define DFT_FLOAT
+#endif
+#else
+#include <fftw3.h>
+#endif
+
+#if defined(DFT_FIXED)
+typedef float DFTReal;
+#define DFTSqrt                 sqrtf
+#define DFT_WISDOM_FILE         NULL
+#elif defined(DFT_FLOAT)
+typedef float DFTReal;
+#define DFTW(name)              fftwf_##name
+#define DFTSqrt                 sqrtf
+#define DFT_WISDOM_FILE         "fftwf.wis"
+#else
+typedef double DFTReal;
+#define DFTW(name)              fftw_##name
+#define DFTSqrt                 sqrt
+#define DFT_WISDOM_FILE         "fftw.wis"
+#endif
+#define DFT_MAXPLANS            32
+
+/* FFTW_PATIENT gives slightly faster plans but takes minutes to plan the largest buffers
+   the first time; the result is kept in the wisdom file anyway. */
+#ifndef DFT_PLANNER_FLAGS
+#define DFT_PLANNER_FLAGS       FFTW_MEASURE
+#endif
+
+/* Cost of one Goertzel step (one sample, one bin) against one unit of N*log2(N) for the FFT.
+   ProcessDFTPower runs Goertzel filters instead of the transform when that is cheaper: only when a
+   handful of bins is wanted, the benchmark mode tells where the limit is on a given machine. */
+#ifndef DFT_GOERTZEL_COST
+#define DFT_GOERTZEL_COST       2.0
+#endif
+
+/* Build with DFT_WINDOW_HANN to weight the samples of every transform by a Hann window, scaled so that
+   the mean power of the signal does not change and the thresholds keep their meaning. The STFT frames
+   do not overlap, a snap falling on the edge of a frame would be attenuated: it is off by default. */
+
+/* A plan transforms nbChannels interleaved channels at once (one fftw_plan_many_dft_r2c call): dataIn
+   holds the samples interleaved as they are recorded, dataOut and modules the spectra one after another. */
+typedef struct
+{
+    unsigned int length,
+                 nbChannels,
+                 lastUse,
+                 nbUsers;
+    DFTReal *dataIn,
+            *modules,
+            *window;
+#ifdef DFT_FIXED
+    FixedFFT fft;
+#else
+    DFTW(complex) *dataOut;
+    DFTW(plan) plan;
+#endif
+    SDL_mutex *mutex;
+} DFTPlan;
+
+int InitDFT(const char wisdomFileName[]);
+void QuitDFT(const char wisdomFileName[]);
+int SaveDFTWisdom(const char wisdomFileName[]);
+
+DFTPlan* AcquireDFTPlan(unsigned int length);
+DFTPlan* AcquireDFTBatchPlan(unsigned int length, unsigned int nbChannels);
+void ReleaseDFTPlan(DFTPlan *dftPlan);
+DFTReal* ProcessDFT(DFTPlan *dftPlan, const void *pcmData, unsigned int pcmLength, int format, DFTReal *modules);
+DFTReal* ProcessDFTPower(DFTPlan *dftPlan, const void *pcmData, unsigned int pcmLength, int format, DFTReal *powers, unsigned int nbBins);
+void ProcessDFTBatchPower(DFTPlan *dftPlan, const void *pcmData, unsigned int pcmLength, int format, DFTReal *powers[], unsigned int nbBins);
+int IsGoertzelCheaper(unsigned int length, unsigned int pcmLength, unsigned int nbBins);
+unsigned int GetDFTLength(unsigned int length);
+
+#endif
@@ -0,0 +1,139 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "atomics.h"
+#include "dispatch.h"
+
+static int ExecutorThread(void *param);
+
+
+int StartActionQueue(ActionQueue *queue, void (*function)(void *item, void *param), void *param, unsigned int itemSize,
+                     unsigned int maxItems, Uint32 debounce_ms, int isCoalescing)
+{
+    memset(queue, 0, sizeof(ActionQueue));
+    queue->function = function;
+    queue->param = param;
+    queue->itemSize = itemSize;
+    queue->maxItems = maxItems > 0 ? maxItems : 1;
+    queue->debounce_ms = debounce_ms;
+    queue->isCoalescing = isCoalescing;
+    queue->isRunning = 1;
+
+    if ( !(queue->items = malloc(queue->itemSize * queue->maxItems))
+        || !(queue->current = malloc(queue->itemSize))
+        || !(queue->mutex = SDL_CreateMutex())
+        || !(queue->semaphore = SDL_CreateSemaphore(0))
+        || !(queue->thread = SDL_CreateThread(ExecutorThread, queue)) )
+    {
+        queue->isRunning = 0;
+        StopActionQueue(queue);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* time (SDL_GetTicks) is when the request was made, for the debounce. Returns 1 if the request was
+   queued, 0 if it replaced a waiting one or was dropped. */
+int PostAction(ActionQueue *queue, const void *item, Uint32 time)
+{
+    int isQueued = 0;
+
+    if (!AtomicGet(&queue->isRunning))
+        return 0;
+
+    AtomicAdd(&queue->nbPosted, 1);
+    SDL_mutexP(queue->mutex);
+
+    if (queue->hasPosted && time - queue->lastPostTime < queue->debounce_ms)
+        AtomicAdd(&queue->nbDebounced, 1);
+    else
+    {
+        queue->hasPosted = 1;
+        queue->lastPostTime = time;
+
+        if (queue->nbItems == queue->maxItems)
+        {
+            if (queue->isCoalescing)
+            {
+                memcpy(queue->items + ((queue->first + queue->nbItems - 1) % queue->maxItems) * queue->itemSize, item, queue->itemSize);
+                AtomicAdd(&queue->nbCoalesced, 1);
+            }
+            else AtomicAdd(&queue->nbDropped, 1);
+        }
+        else
+        {
+            memcpy(queue->items + ((queue->first + queue->nbItems) % queue->maxItems) * queue->itemSize, item, queue->itemSize);
+            queue->nbItems++;
+            isQueued = 1;
+        }
+    }
+
+    SDL_mutexV(queue->mutex);
+    if (isQueued)
+        SDL_SemPost(queue->semaphore);
+    return isQueued;
+}
+
+/* Waits for the action being run, if any, the requests still waiting are dropped */
+void StopActionQueue(ActionQueue *queue)
+{
+    if (queue->thread)
+    {
+        AtomicSet(&queue->isRunning, 0);
+        SDL_SemPost(queue->semaphore);
+        SDL_WaitThread(queue->thread, NULL);
+    }
+
+    if (queue->semaphore)
+        SDL_DestroySemaphore(queue->semaphore);
+    if (queue->mutex)
+        SDL_DestroyMutex(queue->mutex);
+    free(queue->items);
+    free(queue->current);
+
+    queue->thread = NULL;
+    queue->semaphore = NULL;
+    queue->mutex = NULL;
+    queue->items = NULL;
+    queue->current = NULL;
+}
+
+/* The item is copied out, so that the queue takes new requests while the action runs */
+static int ExecutorThread(void *param)
+{
+    ActionQueue *queue = param;
+
+    while (1)
+    {
+        SDL_SemWait(queue->semaphore);
+        if (!AtomicGet(&queue->isRunning))
+            break;
+
+        SDL_mutexP(queue->mutex);
+        memcpy(queue->current, queue->items + queue->first * queue->itemSize, queue->itemSize);
+        queue->first = (queue->first + 1) % queue->maxItems;
+        queue->nbItems--;
+        SDL_mutexV(queue->mutex);
+
+        queue->function(queue->current, queue->param);
+        AtomicAdd(&queue->nbExecuted, 1);
+    }
+
+    return 1;
+}
@@ -0,0 +1,61 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef DISPATCHH
+
+#define DISPATCHH
+
+#include <SDL.h>
+
+/* Bounded queue of actions, run one after the other by their own thread (the executor), so that a
+   slow action never holds up the thread which posts it.
+   Each request is an item of itemSize bytes, copied into the queue, which the executor gives to
+   function(item, param). A request is dropped when it comes less than debounce_ms after the last
+   one that was taken (debounced). When maxItems requests are already waiting, a new one replaces the
+   last of them with isCoalescing (coalesced): the queue then always ends with the latest request.
+   Otherwise it is dropped.
+   Posting never waits for the executor, which only holds the lock to take an item out. */
+typedef struct
+{
+    void (*function)(void *item, void *param);
+    void *param;
+    unsigned int itemSize,
+                 maxItems,
+                 first,
+                 nbItems;
+    Uint32 debounce_ms,
+           lastPostTime;
+    int isCoalescing,
+        hasPosted;
+    Uint8 *items,
+          *current;
+    SDL_Thread *thread;
+    SDL_mutex *mutex;
+    SDL_sem *semaphore;
+    volatile int isRunning;
+    volatile Uint32 nbPosted,
+                    nbExecuted,
+                    nbCoalesced,
+                    nbDebounced,
+                    nbDropped;
+} ActionQueue;
+
+int StartActionQueue(ActionQueue *queue, void (*function)(void *item, void *param), void *param, unsigned int itemSize,
+                     unsigned int maxItems, Uint32 debounce_ms, int isCoalescing);
+int PostAction(ActionQueue *queue, const void *item, Uint32 time);
+void StopActionQueue(ActionQueue *queue);
+
+#endif
@@ -0,0 +1,118 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "atomics.h"
+#include "bands.h"
+#include "display.h"
+
+/* Set in middle when the slot it holds was published after the reader last looked */
+#define DISPLAY_FRESH           4
+
+
+/* The columns split the frameLength/2+1 bins evenly, a column gets at least one bin */
+void DecimateSpectrum(DisplaySpectrum *spectrum, const DFTReal *modules, unsigned int frameLength, unsigned int samplingFreq, unsigned int nbColumns)
+{
+    unsigned int i, j, from, to,
+                 nbBins = frameLength/2 + 1;
+
+    if (nbColumns > DISPLAY_MAXCOLUMNS)
+        nbColumns = DISPLAY_MAXCOLUMNS;
+    else if (nbColumns < 1)
+        nbColumns = 1;
+
+    spectrum->nbColumns = nbColumns;
+    spectrum->meanMax = 0;
+
+    for (j=0 ; j < nbColumns ; j++)
+    {
+        from = j*nbBins/nbColumns;
+        if ((to = (j+1)*nbBins/nbColumns) <= from)
+            to = from+1;
+
+        spectrum->means[j] = SumBins(modules, from, to) / (to-from);
+        spectrum->maxima[j] = modules[from];
+        for (i=from+1 ; i < to ; i++)
+        {
+            if (modules[i] > spectrum->maxima[j])
+                spectrum->maxima[j] = modules[i];
+        }
+
+        if (spectrum->means[j] > spectrum->meanMax)
+            spectrum->meanMax = spectrum->means[j];
+    }
+
+    GetBandPowers(modules, frameLength, samplingFreq, spectrum->bandPowers);
+}
+
+int InitDisplayBuffer(DisplayBuffer *display)
+{
+    memset(display, 0, sizeof(DisplayBuffer));
+
+    if ( !(display->slots = calloc(3, sizeof(DisplaySpectrum))) )
+        return 0;
+
+    display->back = 0;
+    display->middle = 1;
+    display->front = 2;
+    return 1;
+}
+
+void FreeDisplayBuffer(DisplayBuffer *display)
+{
+    free(display->slots);
+    memset(display, 0, sizeof(DisplayBuffer));
+}
+
+DisplaySpectrum* GetDisplayBack(DisplayBuffer *display)
+{
+    return display->slots ? &display->slots[display->back] : NULL;
+}
+
+void PublishDisplay(DisplayBuffer *display)
+{
+    Uint32 middle;
+
+    do
+    {
+        middle = display->middle;
+    } while (!AtomicCAS(&display->middle, middle, display->back | DISPLAY_FRESH));
+
+    display->back = middle & ~DISPLAY_FRESH;
+}
+
+/* NULL until a first spectrum is published */
+const DisplaySpectrum* ReadDisplay(DisplayBuffer *display)
+{
+    Uint32 middle;
+
+    if (!display->slots)
+        return NULL;
+
+    if (AtomicGet(&display->middle) & DISPLAY_FRESH)
+    {
+        do
+        {
+            middle = display->middle;
+        } while (!AtomicCAS(&display->middle, middle, display->front));
+
+        display->front = middle & ~DISPLAY_FRESH;
+        display->hasFront = 1;
+    }
+
+    return display->hasFront ? &display->slots[display->front] : NULL;
+}
@@ -0,0 +1,57 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef DISPLAYH
+
+#define DISPLAYH
+
+#include <SDL.h>
+#include "dft.h"
+
+#define DISPLAY_MAXCOLUMNS      1024
+
+/* Spectrum cut down to the columns of the display: mean and maximum magnitude of the bins of each
+   column, the largest column mean (the scale of the drawing) and the band powers of GetBandPowers. */
+typedef struct
+{
+    unsigned int nbColumns;
+    DFTReal means[DISPLAY_MAXCOLUMNS],
+            maxima[DISPLAY_MAXCOLUMNS],
+            meanMax;
+    double bandPowers[4];
+} DisplaySpectrum;
+
+/* Lock-free triple buffer handing spectra from the analysis to the display. The writer fills its back
+   slot (GetDisplayBack) then publishes it, the reader always gets the last one published, and neither
+   ever waits for the other. Only one thread may write and one may read. */
+typedef struct
+{
+    DisplaySpectrum *slots;
+    unsigned int back,
+                 front;
+    int hasFront;
+    volatile Uint32 middle;
+} DisplayBuffer;
+
+void DecimateSpectrum(DisplaySpectrum *spectrum, const DFTReal *modules, unsigned int frameLength, unsigned int samplingFreq, unsigned int nbColumns);
+
+int InitDisplayBuffer(DisplayBuffer *display);
+void FreeDisplayBuffer(DisplayBuffer *display);
+DisplaySpectrum* GetDisplayBack(DisplayBuffer *display);
+void PublishDisplay(DisplayBuffer *display);
+const DisplaySpectrum* ReadDisplay(DisplayBuffer *display);
+
+#endif
@@ -0,0 +1,159 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "features.h"
+#include "bands.h"
+#include "model.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define FEATURES_EPSILON        1e-12
+
+static double GetMel(double frequency);
+static void GetFilterEnergies(const FeatureExtractor *extractor, const DFTReal *powers, double energies[FEATURES_NBFILTERS]);
+
+
+int InitFeatureExtractor(FeatureExtractor *extractor, unsigned int frameLength, unsigned int samplingFreq)
+{
+    unsigned int tabBands[] = {0, BAND1, BAND2, BAND3, BAND4},
+                 i, j;
+    double melStep = GetMel(BAND4) / (FEATURES_NBFILTERS+1),
+           position;
+
+    memset(extractor, 0, sizeof(FeatureExtractor));
+    extractor->nbBins = BAND4*frameLength/samplingFreq + 1;
+    for (i=0 ; i < 5 ; i++)
+        extractor->tabBands[i] = tabBands[i]*frameLength/samplingFreq;
+
+    extractor->binFilters = malloc(extractor->nbBins);
+    extractor->binWeights = malloc(sizeof(float) * extractor->nbBins);
+    if (!extractor->binFilters || !extractor->binWeights)
+    {
+        FreeFeatureExtractor(extractor);
+        return 0;
+    }
+
+    /* Filter k rises from the mel point k to k+1 and falls down to k+2 */
+    for (i=0 ; i < extractor->nbBins ; i++)
+    {
+        position = GetMel((double)i*samplingFreq/frameLength) / melStep;
+        if (position >= FEATURES_NBFILTERS+1)
+            position = FEATURES_NBFILTERS+1 - 1e-6;
+        extractor->binFilters[i] = (Uint8)position;
+        extractor->binWeights[i] = position - (Uint8)position;
+    }
+
+    /* DCT-II, the first coefficient (the overall level) is left out */
+    for (i=0 ; i < FEATURES_NBCEPSTRA ; i++)
+    {
+        for (j=0 ; j < FEATURES_NBFILTERS ; j++)
+            extractor->cepstra[i][j] = cos(M_PI * (i+1) * (j+0.5) / FEATURES_NBFILTERS) / FEATURES_NBFILTERS;
+    }
+
+    return 1;
+}
+
+void FreeFeatureExtractor(FeatureExtractor *extractor)
+{
+    free(extractor->binFilters);
+    free(extractor->binWeights);
+    memset(extractor, 0, sizeof(FeatureExtractor));
+}
+
+/* powers, previousPowers and noisePowers are frame powers, at least up to BAND4 */
+void ExtractFeatures(const FeatureExtractor *extractor, const DFTReal *powers, const DFTReal *previousPowers, const DFTReal *noisePowers,
+                     float features[FEATURES_SIZE])
+{
+    double energies[FEATURES_NBFILTERS],
+           previousEnergies[FEATURES_NBFILTERS],
+           noiseEnergies[FEATURES_NBFILTERS],
+           sum, weightedSum, excess, flux;
+    unsigned int i, k;
+
+    for (i=0 ; i < 4 ; i++)
+    {
+        features[FEATURE_BAND1 + i] = log10((SumBins(powers, extractor->tabBands[i], extractor->tabBands[i+1]) + FEATURES_EPSILON)
+                                            / (SumBins(noisePowers, extractor->tabBands[i], extractor->tabBands[i+1]) + FEATURES_EPSILON));
+    }
+
+    for (i=0, sum=0, weightedSum=0 ; i < extractor->nbBins ; i++)
+    {
+        if ((excess = powers[i] - noisePowers[i]) > 0)
+        {
+            sum += excess;
+            weightedSum += excess * i;
+        }
+    }
+    features[FEATURE_CENTROID] = sum > 0 ? weightedSum / (sum * extractor->nbBins) : 0;
+
+    GetFilterEnergies(extractor, powers, energies);
+    GetFilterEnergies(extractor, previousPowers, previousEnergies);
+    GetFilterEnergies(extractor, noisePowers, noiseEnergies);
+
+    for (k=0, flux=0 ; k < FEATURES_NBFILTERS ; k++)
+    {
+        energies[k] = log10((energies[k] + FEATURES_EPSILON) / (noiseEnergies[k] + FEATURES_EPSILON));
+        previousEnergies[k] = log10((previousEnergies[k] + FEATURES_EPSILON) / (noiseEnergies[k] + FEATURES_EPSILON));
+        if (energies[k] > previousEnergies[k])
+            flux += energies[k] - previousEnergies[k];
+    }
+    features[FEATURE_FLUX] = flux / FEATURES_NBFILTERS;
+
+    for (i=0 ; i < FEATURES_NBCEPSTRA ; i++)
+    {
+        for (k=0, sum=0 ; k < FEATURES_NBFILTERS ; k++)
+            sum += extractor->cepstra[i][k] * energies[k];
+        features[FEATURE_CEPSTRUM1 + i] = sum;
+    }
+}
+
+/* Logistic regression over the standardized features, with the tables of model.h (made by snapd-train):
+   a frame with a positive score is a snap */
+double ScoreFeatures(const float features[FEATURES_SIZE])
+{
+    double score = CLASSIFIER_BIAS;
+    unsigned int i;
+
+    for (i=0 ; i < FEATURES_SIZE ; i++)
+        score += tabClassifierWeights[i] * (features[i] - tabFeatureMeans[i]) * tabFeatureScales[i];
+
+    return score;
+}
+
+static double GetMel(double frequency)
+{
+    return 2595 * log10(1 + frequency/700);
+}
+
+static void GetFilterEnergies(const FeatureExtractor *extractor, const DFTReal *powers, double energies[FEATURES_NBFILTERS])
+{
+    unsigned int i, k;
+
+    memset(energies, 0, sizeof(double) * FEATURES_NBFILTERS);
+    for (i=0 ; i < extractor->nbBins ; i++)
+    {
+        k = extractor->binFilters[i];
+        if (k < FEATURES_NBFILTERS)
+            energies[k] += extractor->binWeights[i] * powers[i];
+        if (k > 0 && k <= FEATURES_NBFILTERS)
+            energies[k-1] += (1 - extractor->binWeights[i]) * powers[i];
+    }
+}
@@ -0,0 +1,57 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef FEATURESH
+
+#define FEATURESH
+
+#include <SDL.h>
+#include "dft.h"
+
+#define FEATURES_NBFILTERS      16
+#define FEATURES_NBCEPSTRA      4
+#define FEATURES_SIZE           (6 + FEATURES_NBCEPSTRA)
+
+#define FEATURE_BAND1           0
+#define FEATURE_FLUX            4
+#define FEATURE_CENTROID        5
+#define FEATURE_CEPSTRUM1       6
+
+/* Compact description of one STFT frame, for the learned classifier (ScoreFeatures).
+   All the features are taken against the noise floor, so that they do not depend on the level of the
+   microphone: the power of each of the four detection bands over that of the noise (log10), the flux
+   (rise of the filterbank energies since the previous frame), the spectral centroid of the excess over
+   the noise (0 to 1 up to BAND4) and the first cepstral coefficients of the filterbank energies.
+   The filterbank is made of FEATURES_NBFILTERS triangles evenly spaced on the mel scale up to BAND4.
+   Its tables are made once for a frame length, and only go through the bins the detection computes:
+   each bin gives its power to the filter whose rising edge it is on (binWeights) and the rest to the
+   one before. */
+typedef struct
+{
+    unsigned int nbBins,
+                 tabBands[5];
+    Uint8 *binFilters;
+    float *binWeights;
+    float cepstra[FEATURES_NBCEPSTRA][FEATURES_NBFILTERS];
+} FeatureExtractor;
+
+int InitFeatureExtractor(FeatureExtractor *extractor, unsigned int frameLength, unsigned int samplingFreq);
+void FreeFeatureExtractor(FeatureExtractor *extractor);
+void ExtractFeatures(const FeatureExtractor *extractor, const DFTReal *powers, const DFTReal *previousPowers, const DFTReal *noisePowers,
+                     float features[FEATURES_SIZE]);
+double ScoreFeatures(const float features[FEATURES_SIZE]);
+
+#endif
@@ -0,0 +1,348 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fixed.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define FIXED_X86
+#include <immintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* The unit of the points is that of 16 bits samples */
+#define FIXED_UNIT              32512.0
+
+typedef int (*FixedStage)(Sint16 *re, Sint16 *im, unsigned int nbPoints, unsigned int half, const Sint16 *wRe, const Sint16 *wIm, int shift);
+
+static int LoadSamples(FixedFFT *fft, const void *pcmData, unsigned int pcmLength, int format, unsigned int channel, unsigned int nbChannels,
+                       int *exponent);
+static int StageScalar(Sint16 *re, Sint16 *im, unsigned int nbPoints, unsigned int half, const Sint16 *wRe, const Sint16 *wIm, int shift);
+#ifdef FIXED_X86
+static int StageSSSE3(Sint16 *re, Sint16 *im, unsigned int nbPoints, unsigned int half, const Sint16 *wRe, const Sint16 *wIm, int shift);
+#endif
+
+static FixedStage RunStage = NULL;
+
+
+int IsFixedFFTLength(unsigned int length)
+{
+    return length >= FIXED_MINLENGTH && length <= FIXED_MAXLENGTH && !(length & (length-1));
+}
+
+int InitFixedFFT(FixedFFT *fft, unsigned int length)
+{
+    unsigned int i, j, bits, half;
+
+    memset(fft, 0, sizeof(FixedFFT));
+    if (!IsFixedFFTLength(length))
+        return 0;
+
+    if (!RunStage)
+    {
+        RunStage = StageScalar;
+#ifdef FIXED_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("ssse3"))
+            RunStage = StageSSSE3;
+#endif
+    }
+
+    fft->length = length;
+    fft->nbPoints = length/2;
+    fft->bitReverse = malloc(sizeof(unsigned int) * fft->nbPoints);
+    fft->re = malloc(sizeof(Sint16) * fft->nbPoints);
+    fft->im = malloc(sizeof(Sint16) * fft->nbPoints);
+    fft->stageRe = malloc(sizeof(Sint16) * fft->nbPoints);
+    fft->stageIm = malloc(sizeof(Sint16) * fft->nbPoints);
+    fft->splitCos = malloc(sizeof(Sint16) * (fft->nbPoints+1));
+    fft->splitSin = malloc(sizeof(Sint16) * (fft->nbPoints+1));
+    fft->samples = malloc(sizeof(Sint32) * length);
+#ifdef DFT_WINDOW_HANN
+    fft->window = malloc(sizeof(Sint16) * length);
+#endif
+
+    if (!fft->bitReverse || !fft->re || !fft->im || !fft->stageRe || !fft->stageIm || !fft->splitCos || !fft->splitSin || !fft->samples
+#ifdef DFT_WINDOW_HANN
+        || !fft->window
+#endif
+        )
+    {
+        FreeFixedFFT(fft);
+        return 0;
+    }
+
+    for (bits=0 ; (1u << bits) < fft->nbPoints ; bits++);
+    for (i=0 ; i < fft->nbPoints ; i++)
+    {
+        fft->bitReverse[i] = 0;
+        for (j=0 ; j < bits ; j++)
+            fft->bitReverse[i] |= ((i >> j) & 1) << (bits-1-j);
+    }
+
+    /* The twiddles of the stage of half-width half start at half-1 */
+    for (half=1 ; half < fft->nbPoints ; half *= 2)
+    {
+        for (j=0 ; j < half ; j++)
+        {
+            fft->stageRe[half-1+j] = (Sint16)floor(32767*cos(M_PI*j/half) + 0.5);
+            fft->stageIm[half-1+j] = (Sint16)floor(-32767*sin(M_PI*j/half) + 0.5);
+        }
+    }
+
+    for (i=0 ; i <= fft->nbPoints ; i++)
+    {
+        fft->splitCos[i] = (Sint16)floor(32767*cos(2*M_PI*i/length) + 0.5);
+        fft->splitSin[i] = (Sint16)floor(32767*sin(2*M_PI*i/length) + 0.5);
+    }
+
+#ifdef DFT_WINDOW_HANN
+    /* Same window as the floating point transform, sqrt(8/3) times a Hann window: up to 1.63, in Q14 */
+    for (i=0 ; i < length ; i++)
+        fft->window[i] = (Sint16)floor(16384*sqrt(8/3.0) * 0.5 * (1 - cos(2*M_PI*i/length)) + 0.5);
+#endif
+
+    return 1;
+}
+
+void FreeFixedFFT(FixedFFT *fft)
+{
+    free(fft->bitReverse);
+    free(fft->re);
+    free(fft->im);
+    free(fft->stageRe);
+    free(fft->stageIm);
+    free(fft->splitCos);
+    free(fft->splitSin);
+    free(fft->window);
+    free(fft->samples);
+    memset(fft, 0, sizeof(FixedFFT));
+}
+
+/* Squared magnitudes of the first nbBins bins (all length/2+1 of them if nbBins is 0) of one channel of pcmLength interleaved
+   frames, zero padded to the length of the transform */
+void ProcessFixedFFTPower(FixedFFT *fft, const void *pcmData, unsigned int pcmLength, int format, unsigned int channel, unsigned int nbChannels,
+                          float *powers, unsigned int nbBins)
+{
+    unsigned int k, p, q, half,
+                 nbPoints = fft->nbPoints;
+    int maxAbs, shift, exponent;
+    Sint32 ar, ai, br, bi, er, ei, or, oi, xr, xi;
+    float scale;
+
+    if (!nbBins || nbBins > nbPoints+1)
+        nbBins = nbPoints+1;
+
+    if ( !(maxAbs = LoadSamples(fft, pcmData, pcmLength, format, channel, nbChannels, &exponent)) )
+    {
+        memset(powers, 0, sizeof(float) * nbBins);
+        return;
+    }
+
+    for (half=1 ; half < nbPoints ; half *= 2)
+    {
+        for (shift=0 ; (maxAbs >> shift) > FIXED_STAGEMAX ; shift++);
+        exponent += shift;
+        maxAbs = RunStage(fft->re, fft->im, nbPoints, half, fft->stageRe + half-1, fft->stageIm + half-1, shift);
+    }
+
+    /* Z being the transform of the complex points, X[k] = (Z[k] + conj(Z[-k]))/2 - i e^(-2i pi k/length) (Z[k] - conj(Z[-k]))/2,
+       computed twice over (the halves are folded into the scale) */
+    scale = ldexp(1.0, 2*exponent - 2) / (FIXED_UNIT*FIXED_UNIT);
+    for (k=0 ; k < nbBins ; k++)
+    {
+        p = k < nbPoints ? k : 0;
+        q = k > 0 && k < nbPoints ? nbPoints-k : 0;
+        ar = fft->re[p];
+        ai = fft->im[p];
+        br = fft->re[q];
+        bi = -fft->im[q];
+
+        er = ar + br;
+        ei = ai + bi;
+        or = ar - br;
+        oi = ai - bi;
+        xr = er + ((fft->splitCos[k]*oi - fft->splitSin[k]*or + 16384) >> 15);
+        xi = ei - ((fft->splitCos[k]*or + fft->splitSin[k]*oi + 16384) >> 15);
+
+        powers[k] = (float)((Sint64)xr*xr + (Sint64)xi*xi) * scale;
+    }
+}
+
+const char* GetFixedFFTKernelName(void)
+{
+#ifdef FIXED_X86
+    if (RunStage == StageSSSE3)
+        return "SSSE3";
+#endif
+    return "scalar";
+}
+
+/* The samples are taken in the unit of 16 bits samples (clipped there for float ones), windowed, then
+   shifted so that the largest one is just under FIXED_STAGEMAX: the shift is the first exponent of the
+   transform. They land in bit-reversed order, ready for the stages. Returns the largest of them, 0 if
+   all are null. */
+static int LoadSamples(FixedFFT *fft, const void *pcmData, unsigned int pcmLength, int format, unsigned int channel, unsigned int nbChannels,
+                       int *exponent)
+{
+    unsigned int i, j;
+    Sint32 value, maxAbs = 0;
+    float sample;
+    int shift = 0;
+
+    if (pcmLength > fft->length)
+        pcmLength = fft->length;
+
+    for (i=0, j=channel ; i < pcmLength ; i++, j += nbChannels)
+    {
+        if (format == PCM_FORMAT_PCM16)
+            value = ((const Sint16*)pcmData)[j];
+        else if (format == PCM_FORMAT_FLOAT)
+        {
+            sample = ((const float*)pcmData)[j] * FIXED_UNIT;
+            value = sample > 32767 ? 32767 : (sample < -32767 ? -32767 : (Sint32)floor(sample + 0.5));
+        }
+        else value = ((const Sint8*)pcmData)[j] * 256;
+
+        if (fft->window)
+            value = (value * fft->window[i] + 8192) >> 14;
+
+        fft->samples[i] = value;
+        if (abs(value) > maxAbs)
+            maxAbs = abs(value);
+    }
+    for ( ; i < fft->length ; i++)
+        fft->samples[i] = 0;
+
+    if (!maxAbs)
+        return 0;
+
+    while ((maxAbs >> shift) > FIXED_STAGEMAX)
+        shift++;
+    while (shift <= 0 && shift > -15 && (maxAbs << (1-shift)) <= FIXED_STAGEMAX)
+        shift--;
+    *exponent = shift;
+
+    for (i=0 ; i < fft->nbPoints ; i++)
+    {
+        j = fft->bitReverse[i];
+        fft->re[j] = shift >= 0 ? fft->samples[2*i] >> shift : fft->samples[2*i] << -shift;
+        fft->im[j] = shift >= 0 ? fft->samples[2*i+1] >> shift : fft->samples[2*i+1] << -shift;
+    }
+
+    return shift >= 0 ? maxAbs >> shift : maxAbs << -shift;
+}
+
+/* One stage of butterflies on groups of 2*half points, the inputs shifted right by shift first. The
+   products are rounded one by one as _mm_mulhrs_epi16 does, so that both kernels give the same points.
+   Returns the largest output (in absolute value), which decides the shift of the next stage. */
+static int StageScalar(Sint16 *re, Sint16 *im, unsigned int nbPoints, unsigned int half, const Sint16 *wRe, const Sint16 *wIm, int shift)
+{
+    unsigned int start, j, a, b;
+    Sint32 ar, ai, br, bi, tr, ti, maxAbs = 0;
+
+    for (start=0 ; start < nbPoints ; start += 2*half)
+    {
+        for (j=0 ; j < half ; j++)
+        {
+            a = start + j;
+            b = a + half;
+            ar = re[a] >> shift;
+            ai = im[a] >> shift;
+            br = re[b] >> shift;
+            bi = im[b] >> shift;
+
+            tr = ((br*wRe[j] + 16384) >> 15) - ((bi*wIm[j] + 16384) >> 15);
+            ti = ((br*wIm[j] + 16384) >> 15) + ((bi*wRe[j] + 16384) >> 15);
+
+            re[a] = ar + tr;
+            im[a] = ai + ti;
+            re[b] = ar - tr;
+            im[b] = ai - ti;
+
+            if (abs(re[a]) > maxAbs) maxAbs = abs(re[a]);
+            if (abs(im[a]) > maxAbs) maxAbs = abs(im[a]);
+            if (abs(re[b]) > maxAbs) maxAbs = abs(re[b]);
+            if (abs(im[b]) > maxAbs) maxAbs = abs(im[b]);
+        }
+    }
+
+    return maxAbs;
+}
+
+#ifdef FIXED_X86
+
+/* SSSE3: 8 butterflies at once, for the stages with groups of at least 8 */
+__attribute__((target("ssse3")))
+static int StageSSSE3(Sint16 *re, Sint16 *im, unsigned int nbPoints, unsigned int half, const Sint16 *wRe, const Sint16 *wIm, int shift)
+{
+    unsigned int start, j, a, b;
+    __m128i ar, ai, br, bi, tr, ti, wr, wi, out,
+            count = _mm_cvtsi32_si128(shift),
+            maxAbs = _mm_setzero_si128();
+    Sint16 result[8];
+    int i, m = 0;
+
+    if (half < 8)
+        return StageScalar(re, im, nbPoints, half, wRe, wIm, shift);
+
+    for (start=0 ; start < nbPoints ; start += 2*half)
+    {
+        for (j=0 ; j < half ; j += 8)
+        {
+            a = start + j;
+            b = a + half;
+            ar = _mm_sra_epi16(_mm_loadu_si128((const __m128i*)(re+a)), count);
+            ai = _mm_sra_epi16(_mm_loadu_si128((const __m128i*)(im+a)), count);
+            br = _mm_sra_epi16(_mm_loadu_si128((const __m128i*)(re+b)), count);
+            bi = _mm_sra_epi16(_mm_loadu_si128((const __m128i*)(im+b)), count);
+            wr = _mm_loadu_si128((const __m128i*)(wRe+j));
+            wi = _mm_loadu_si128((const __m128i*)(wIm+j));
+
+            tr = _mm_sub_epi16(_mm_mulhrs_epi16(br, wr), _mm_mulhrs_epi16(bi, wi));
+            ti = _mm_add_epi16(_mm_mulhrs_epi16(br, wi), _mm_mulhrs_epi16(bi, wr));
+
+            out = _mm_add_epi16(ar, tr);
+            _mm_storeu_si128((__m128i*)(re+a), out);
+            maxAbs = _mm_max_epi16(maxAbs, _mm_abs_epi16(out));
+            out = _mm_add_epi16(ai, ti);
+            _mm_storeu_si128((__m128i*)(im+a), out);
+            maxAbs = _mm_max_epi16(maxAbs, _mm_abs_epi16(out));
+            out = _mm_sub_epi16(ar, tr);
+            _mm_storeu_si128((__m128i*)(re+b), out);
+            maxAbs = _mm_max_epi16(maxAbs, _mm_abs_epi16(out));
+            out = _mm_sub_epi16(ai, ti);
+            _mm_storeu_si128((__m128i*)(im+b), out);
+            maxAbs = _mm_max_epi16(maxAbs, _mm_abs_epi16(out));
+        }
+    }
+
+    _mm_storeu_si128((__m128i*)result, maxAbs);
+    for (i=0 ; i < 8 ; i++)
+    {
+        if (result[i] > m)
+            m = result[i];
+    }
+    return m;
+}
+
+#endif
@@ -0,0 +1,62 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+#ifndef FIXEDH
+
+#define FIXEDH
+
+#include <SDL.h>
+#include "pcm.h"
+
+#define FIXED_MINLENGTH         4
+#define FIXED_MAXLENGTH         65536
+
+/* Headroom left before each butterfly stage: an output can be (1+sqrt(2)) times the largest input */
+#define FIXED_STAGEMAX          13500
+
+/* Real transform in Q15 fixed point, for lengths which are powers of two.
+   The length real samples are taken as length/2 complex ones (even samples as real parts, odd samples as
+   imaginary parts), transformed by an in-place radix-2 FFT and split back into the spectrum of the real
+   signal. The points are kept as 16 bits integers, real and imaginary parts in two arrays so that the
+   butterflies of a stage run 8 at a time (SSSE3) once the groups are wide enough.
+   The scaling is block floating point: the samples are shifted to use the 16 bits fully, then each stage
+   is halved (or quartered) only when its inputs could overflow; the shifts are summed up and undone on
+   the powers, which come out with the same scale as those of the floating point transform.
+   With DFT_WINDOW_HANN the samples are weighted by the same window, kept in Q14. */
+typedef struct
+{
+    unsigned int length,
+                 nbPoints;
+    unsigned int *bitReverse;
+    Sint16 *re,
+           *im,
+           *stageRe,
+           *stageIm,
+           *splitCos,
+           *splitSin,
+           *window;
+    Sint32 *samples;
+} FixedFFT;
+
+int IsFixedFFTLength(unsigned int length);
+int InitFixedFFT(FixedFFT *fft, unsigned int length);
+void FreeFixedFFT(FixedFFT *fft);
+void ProcessFixedFFTPower(FixedFFT *fft, const void *pcmData, unsigned int pcmLength, int format, unsigned int channel, unsigned int nbChannels,
+                          float *powers, unsigned int nbBins);
+const char* GetFixedFFTKernelName(void);
+
+#endif
@@ -0,0 +1,101 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <string.h>
+#include "gate.h"
+
+static double GetHighPassEnergy(const void *pcmData, unsigned int length, int format, unsigned int nbChannels);
+
+
+void InitTransientGate(TransientGate *gate)
+{
+    memset(gate, 0, sizeof(TransientGate));
+    gate->refreshFrames = GATE_REFRESHFRAMES;
+}
+
+/* length frames of nbChannels interleaved samples. Returns GATE_CLOSED if the frame is not worth
+   a transform, GATE_OPEN if it may hold (or follow) an onset, GATE_REFRESH for the periodic ones. */
+int UpdateTransientGate(TransientGate *gate, const void *pcmData, unsigned int length, int format, unsigned int nbChannels)
+{
+    double energy = GetHighPassEnergy(pcmData, length, format, nbChannels);
+    int isJump = gate->nbBackgroundFrames > 0 && energy > GATE_RATIO * gate->background,
+        isOpen, isRefresh;
+
+    if (isJump)
+        gate->holdFrames = GATE_HOLDFRAMES;
+    else
+    {
+        /* Cumulative average until the time constant, then exponential */
+        if (gate->nbBackgroundFrames < GATE_TIMECONSTANT)
+            gate->nbBackgroundFrames++;
+        gate->background += (energy - gate->background) / gate->nbBackgroundFrames;
+    }
+
+    isOpen = isJump || gate->holdFrames > 0;
+    isRefresh = !isOpen && ++gate->sinceRefresh >= gate->refreshFrames;
+    if (!isJump && gate->holdFrames > 0)
+        gate->holdFrames--;
+    if (isOpen || isRefresh)
+        gate->sinceRefresh = 0;
+
+    gate->nbFrames++;
+    if (isOpen || isRefresh)
+        gate->nbOpenFrames++;
+
+    return isOpen ? GATE_OPEN : (isRefresh ? GATE_REFRESH : GATE_CLOSED);
+}
+
+/* Sum of the squared differences between consecutive samples of each channel, in [-1,1] units squared.
+   Integer samples are differentiated and squared in integers: a few cycles per sample. */
+static double GetHighPassEnergy(const void *pcmData, unsigned int length, int format, unsigned int nbChannels)
+{
+    unsigned int i, nbSamples = length * nbChannels;
+    Sint64 sum = 0;
+    Sint32 d;
+    double fsum = 0, fd,
+           scale = GetPCMScale(format);
+
+    if (format == PCM_FORMAT_FLOAT)
+    {
+        const float *data = pcmData;
+        for (i=nbChannels ; i < nbSamples ; i++)
+        {
+            fd = data[i] - data[i-nbChannels];
+            fsum += fd*fd;
+        }
+        return fsum * scale*scale;
+    }
+    else if (format == PCM_FORMAT_PCM16)
+    {
+        const Sint16 *data = pcmData;
+        for (i=nbChannels ; i < nbSamples ; i++)
+        {
+            d = data[i] - data[i-nbChannels];
+            sum += (Sint64)d*d;
+        }
+    }
+    else
+    {
+        const Sint8 *data = pcmData;
+        for (i=nbChannels ; i < nbSamples ; i++)
+        {
+            d = data[i] - data[i-nbChannels];
+            sum += d*d;
+        }
+    }
+
+    return sum * scale*scale;
+}
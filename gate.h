@@ -0,0 +1,54 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef GATEH
+
+#define GATEH
+
+#include <SDL.h>
+#include "pcm.h"
+
+#define GATE_RATIO              2.0
+#define GATE_TIMECONSTANT       50
+#define GATE_HOLDFRAMES         2
+#define GATE_REFRESHFRAMES      8
+
+#define GATE_CLOSED             0
+#define GATE_OPEN               1
+#define GATE_REFRESH            2
+
+/* Time-domain transient gate, deciding for each frame whether it is worth a transform.
+   A snap is a sharp onset: the energy of the first difference of the samples (a crude high-pass)
+   jumps well above its running average. The gate opens on such a jump and stays open for
+   GATE_HOLDFRAMES more frames; it also opens once every refreshFrames frames so that the noise
+   model keeps learning, slowly, while the room is quiet (GATE_REFRESH). That is GATE_REFRESHFRAMES
+   until the owner of the gate says otherwise: the STFT spaces the refreshes out once its noise model
+   has settled. Frames which were jumps do not enter the average. */
+typedef struct
+{
+    double background;
+    unsigned int nbBackgroundFrames,
+                 holdFrames,
+                 refreshFrames,
+                 sinceRefresh;
+    Uint32 nbFrames,
+           nbOpenFrames;
+} TransientGate;
+
+void InitTransientGate(TransientGate *gate);
+int UpdateTransientGate(TransientGate *gate, const void *pcmData, unsigned int length, int format, unsigned int nbChannels);
+
+#endif
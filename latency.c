@@ -0,0 +1,90 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <string.h>
+#include "latency.h"
+
+
+void InitLatencyHistogram(LatencyHistogram *histogram, const char name[])
+{
+    memset(histogram, 0, sizeof(LatencyHistogram));
+    strncpy(histogram->name, name, sizeof(histogram->name) - 1);
+}
+
+void AddLatency(LatencyHistogram *histogram, Uint32 latency_ms)
+{
+    unsigned int i = latency_ms / LATENCY_BUCKETMS;
+
+    histogram->buckets[i < LATENCY_NBBUCKETS ? i : LATENCY_NBBUCKETS]++;
+    histogram->count++;
+    histogram->sum += latency_ms;
+    if (latency_ms > histogram->max)
+        histogram->max = latency_ms;
+}
+
+/* Upper bound of the bucket holding the percentile (in [0,100]), at most the maximum */
+Uint32 GetLatencyPercentile(const LatencyHistogram *histogram, double percentile)
+{
+    unsigned int i;
+    Uint32 n = 0;
+
+    if (!histogram->count)
+        return 0;
+
+    for (i=0 ; i < LATENCY_NBBUCKETS ; i++)
+    {
+        n += histogram->buckets[i];
+        if (n >= percentile/100 * histogram->count)
+            return (i+1) * LATENCY_BUCKETMS < histogram->max ? (i+1) * LATENCY_BUCKETMS : histogram->max;
+    }
+
+    return histogram->max;
+}
+
+/* One summary line per histogram, then their non-empty buckets side by side */
+void WriteLatencyHistograms(FILE *file, const LatencyHistogram tabHistograms[], unsigned int nbHistograms)
+{
+    unsigned int i, j;
+    int isEmpty;
+
+    fprintf(file, "%-30s %8s %8s %8s %8s %8s\n", "Stage", "count", "mean", "p50", "p90", "max");
+    for (j=0 ; j < nbHistograms ; j++)
+    {
+        fprintf(file, "%-30s %8d %8.1f %8d %8d %8d\n", tabHistograms[j].name, tabHistograms[j].count,
+                tabHistograms[j].count ? tabHistograms[j].sum / tabHistograms[j].count : 0,
+                GetLatencyPercentile(&tabHistograms[j], 50), GetLatencyPercentile(&tabHistograms[j], 90), tabHistograms[j].max);
+    }
+
+    fprintf(file, "\n%-10s", "ms");
+    for (j=0 ; j < nbHistograms ; j++)
+        fprintf(file, " %10d", j+1);
+    fprintf(file, "\n");
+
+    for (i=0 ; i <= LATENCY_NBBUCKETS ; i++)
+    {
+        for (j=0, isEmpty=1 ; j < nbHistograms ; j++)
+            isEmpty = isEmpty && !tabHistograms[j].buckets[i];
+        if (isEmpty)
+            continue;
+
+        if (i < LATENCY_NBBUCKETS)
+            fprintf(file, "%4d-%-5d", i*LATENCY_BUCKETMS, (i+1)*LATENCY_BUCKETMS);
+        else fprintf(file, "%4d+     ", i*LATENCY_BUCKETMS);
+        for (j=0 ; j < nbHistograms ; j++)
+            fprintf(file, " %10d", tabHistograms[j].buckets[i]);
+        fprintf(file, "\n");
+    }
+}
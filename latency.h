@@ -0,0 +1,43 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef LATENCYH
+
+#define LATENCYH
+
+#include <stdio.h>
+#include <SDL.h>
+
+#define LATENCY_BUCKETMS        5
+#define LATENCY_NBBUCKETS       200
+
+/* Histogram of latencies in milliseconds, in LATENCY_BUCKETMS buckets; the last bucket takes
+   everything from LATENCY_NBBUCKETS*LATENCY_BUCKETMS ms on. Only one thread may add to it. */
+typedef struct
+{
+    char name[30];
+    Uint32 buckets[LATENCY_NBBUCKETS+1],
+           count,
+           max;
+    double sum;
+} LatencyHistogram;
+
+void InitLatencyHistogram(LatencyHistogram *histogram, const char name[]);
+void AddLatency(LatencyHistogram *histogram, Uint32 latency_ms);
+Uint32 GetLatencyPercentile(const LatencyHistogram *histogram, double percentile);
+void WriteLatencyHistograms(FILE *file, const LatencyHistogram tabHistograms[], unsigned int nbHistograms);
+
+#endif
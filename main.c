@@ -20,35 +20,53 @@ GNU General Public License for more details.
 
 #define EXPERIMENTAL_MODE 1
 #define FINAL_MODE 2
+#define BATCH_MODE 3
+#define BENCHMARK_MODE 4
+#define TRAINING_MODE 5
+#define DAEMON_MODE 6
 
+#ifndef CURRENT_MODE
 #define CURRENT_MODE FINAL_MODE
+#endif
 
 //////////////////////////////////////////////
 
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <math.h>
+#if (CURRENT_MODE==EXPERIMENTAL_MODE || CURRENT_MODE==FINAL_MODE)
 #include <conio.h>
 #include <FMOD.h>
+#endif
 #include <SDL.h>
-#include <fftw3.h>
+#include "dft.h"
+#include "detector.h"
+#include "source.h"
+#include "worker.h"
+#include "latency.h"
+#include "display.h"
+#include "record.h"
+#include "dispatch.h"
 
 #define MAX_STRING              512
-#define TIMESPACEMIN            300
-
-#define BAND1                   350
-#define BAND2                   1750
-#define BAND3                   3000
-#define BAND4                   5000
+#define SOUNDBUFFERLENGTH_FACTOR 10
+#define SAMPLELENGTH_MIN        100
+#define SAMPLELENGTH_MAX        1000
+#define ACTION_MAXQUEUE         4
+#define ACTION_DEBOUNCE         500
 
+#if (CURRENT_MODE==EXPERIMENTAL_MODE || CURRENT_MODE==FINAL_MODE)
 static FMOD_SYSTEM *mainFMODSystem = NULL;
+#endif
 
-static FMOD_SOUND* CreateSoundBuffer(unsigned int length, unsigned int samplingFreq);
-static double* ProcessDFT(Sint8* pcmData, unsigned int sampleLength_PCM);
-static int IsSnapshotEx(double *modules, unsigned int sampleLength_PCM, unsigned int samplingFreq, double *sum1_out, double *sum2_out, double *sum3_out, double *sum4_out, double *sum_out);
-static int IsSnapshot(double *modules, unsigned int sampleLength_PCM, unsigned int samplingFreq);
-static int WriteOutputFile(double *modules, const char fileName[], unsigned int sampleLength_PCM, unsigned int samplingRate);
+#if (CURRENT_MODE==EXPERIMENTAL_MODE || CURRENT_MODE==BENCHMARK_MODE)
+static int IsSnapshotEx(DFTReal *modules, unsigned int sampleLength_PCM, unsigned int samplingFreq, double *sum1_out, double *sum2_out, double *sum3_out, double *sum4_out, double *sum_out);
+#endif
+#if (CURRENT_MODE==EXPERIMENTAL_MODE)
+static int WriteOutputFile(DFTReal *modules, const char fileName[], unsigned int sampleLength_PCM, unsigned int samplingRate);
+#endif
 
 //////////////////////////////////////////////
 /* ---------- Experimental mode ----------- */
@@ -58,15 +76,16 @@ static int WriteOutputFile(double *modules, const char fileName[], unsigned int
 
 #define SAMPLELENGTH            250
 #define SAMPLELENGTH_PCM        (SAMPLERATE*SAMPLELENGTH/1000)
+#define SAMPLEFORMAT            PCM_FORMAT_PCM16
 
 #define SCREENW                 640
 #define SCREENH                 480
 
-#define Exit(n) do { FMOD_System_Close(mainFMODSystem); FMOD_System_Release(mainFMODSystem); return n; } while (0)
+#define Exit(n) do { QuitDFT(DFT_WISDOM_FILE); FMOD_System_Close(mainFMODSystem); FMOD_System_Release(mainFMODSystem); return n; } while (0)
 
 static int ChooseInt(int min, int max);
 static unsigned int ChooseDriver(void);
-static int DisplayResults(double *modules, unsigned int screenW, unsigned int screenH);
+static int DisplayResults(DFTReal *modules, unsigned int length, unsigned int screenW, unsigned int screenH);
 static int RecAndWait(FMOD_SOUND *soundBuffer, unsigned int driverId);
 
 
@@ -76,10 +95,11 @@ int main(int argc, char *argv[])
     int time;
     unsigned int driverId, soundLength = 0;
 
-    Sint8 *pcmData1, *pcmData2;
+    void *pcmData1, *pcmData2;
     unsigned int len1, len2;
 
-    double *modules = NULL;
+    DFTPlan *dftPlan = NULL;
+    DFTReal *modules = NULL;
     double sum, sum1, sum2, sum3, sum4;
     int isSnapshot;
 
@@ -90,8 +110,12 @@ int main(int argc, char *argv[])
     FMOD_System_Create(&mainFMODSystem);
     FMOD_System_Init(mainFMODSystem, 1, FMOD_INIT_NORMAL, NULL);
 
+    printf("Initializing FFTW...\n");
+    InitDFT(DFT_WISDOM_FILE);
+    dftPlan = AcquireDFTPlan(GetDFTLength(SAMPLELENGTH_PCM));
+
     printf("Creating sound buffer...\n");
-    soundBuffer = CreateSoundBuffer(SAMPLELENGTH_PCM, SAMPLERATE);
+    soundBuffer = CreateSoundBuffer(mainFMODSystem, SAMPLELENGTH_PCM, SAMPLERATE, SAMPLEFORMAT);
     FMOD_Sound_GetLength(soundBuffer, &soundLength, FMOD_TIMEUNIT_MS);
     printf("Sound created successfully, length: %d ms.\n", soundLength);
 
@@ -105,16 +129,16 @@ int main(int argc, char *argv[])
     printf("Starting record...\n");
     RecAndWait(soundBuffer, driverId);
     printf("\rRecord ok. Extracting PCM data...       \n");
-    FMOD_Sound_Lock(soundBuffer, 0, SAMPLELENGTH_PCM, (void**)&pcmData1, (void**)&pcmData2, &len1, &len2);
+    FMOD_Sound_Lock(soundBuffer, 0, SAMPLELENGTH_PCM * GetPCMSampleSize(SAMPLEFORMAT), &pcmData1, &pcmData2, &len1, &len2);
 
     time = SDL_GetTicks();
     printf("Analysing data...\n");
-    modules = ProcessDFT(pcmData1, SAMPLELENGTH_PCM);
-    FMOD_Sound_Unlock(soundBuffer, (void*)pcmData1, (void*)pcmData2, len1, len2);
+    modules = ProcessDFT(dftPlan, pcmData1, len1 / GetPCMSampleSize(SAMPLEFORMAT), SAMPLEFORMAT, NULL);
+    FMOD_Sound_Unlock(soundBuffer, pcmData1, pcmData2, len1, len2);
     FMOD_Sound_Release(soundBuffer);
 
     printf("Summary:\n");
-    isSnapshot = IsSnapshotEx(modules, SAMPLELENGTH_PCM, SAMPLERATE, &sum1, &sum2, &sum3, &sum4, &sum);
+    isSnapshot = IsSnapshotEx(modules, dftPlan->length, SAMPLERATE, &sum1, &sum2, &sum3, &sum4, &sum);
     printf("\t0.0-%.2f kHz: %.2f\n", BAND1/1000.0, sum1);
     printf("\t%.2f-%.2f kHz: %.2f\n", BAND1/1000.0, BAND2/1000.0, sum2);
     printf("\t%.2f-%.2f kHz: %.2f\n", BAND2/1000.0, BAND3/1000.0, sum3);
@@ -125,15 +149,15 @@ int main(int argc, char *argv[])
     printf("Calculation time: %d ms.\n", SDL_GetTicks()-time);
 
     printf("Saving results...\n");
-    if (!WriteOutputFile(modules, "out.txt", SAMPLELENGTH_PCM, SAMPLERATE))
+    if (!WriteOutputFile(modules, "out.txt", dftPlan->length, SAMPLERATE))
     {
-        free(modules);
+        ReleaseDFTPlan(dftPlan);
         Exit(0);
     }
     printf("Saved in 'out.txt'.\n");
 
-    DisplayResults(modules, SCREENW, SCREENH);
-    free(modules);
+    DisplayResults(modules, dftPlan->length, SCREENW, SCREENH);
+    ReleaseDFTPlan(dftPlan);
     Exit(0);
 }
 
@@ -216,9 +240,9 @@ static unsigned int ChooseDriver(void)
     return driverId;
 }
 
-static int DisplayResults(double *modules, unsigned int screenW, unsigned int screenH)
+static int DisplayResults(DFTReal *modules, unsigned int length, unsigned int screenW, unsigned int screenH)
 {
-    int i, j, interval = (SAMPLELENGTH_PCM/2+1) / screenW;
+    int i, j, interval = (length/2+1) / screenW;
     double sum, modMax=0;
     SDL_Surface *screen = NULL, *surf = NULL;
     SDL_Rect pos;
@@ -236,7 +260,7 @@ static int DisplayResults(double *modules, unsigned int screenW, unsigned int sc
         SDL_Quit();
         return 0;
     }
-    for (j=0 ; j < SAMPLELENGTH_PCM/2+1 ; j+=interval)
+    for (j=0 ; j < length/2+1 ; j+=interval)
     {
         sum = 0;
         for (i=0 ; i < interval ; i++)
@@ -244,7 +268,7 @@ static int DisplayResults(double *modules, unsigned int screenW, unsigned int sc
         if (sum/interval > modMax)
             modMax = sum/interval;
     }
-    for (j=0 ; j < SAMPLELENGTH_PCM/2+1 ; j+=interval)
+    for (j=0 ; j < length/2+1 ; j+=interval)
     {
         sum = 0;
 
@@ -305,16 +329,22 @@ static int RecAndWait(FMOD_SOUND *soundBuffer, unsigned int driverId)
 #include <Windowsx.h>
 #include <Shlobj.h>
 #include "resource.h"
+#include "atomics.h"
 
 #ifndef BIF_NONEWFOLDERBUTTON
 #define BIF_NONEWFOLDERBUTTON 0x00000200
 #endif
 
-#define SOUNDBUFFERLENGTH_FACTOR 10
-#define SAMPLELENGTH_MIN 100
-#define SAMPLELENGTH_MAX 1000
 #define THRESHOLD_MIN 0.1
 #define THRESHOLD_MAX 1.0
+#define WORKER_MAXBACKLOG 2
+#define CAPTURE_FORMAT PCM_FORMAT_PCM16
+#define LATENCY_FILE "latency.txt"
+#define NOISE_FILE "noise.cf"
+#define LOWLATENCY_BUDGET 20
+#define SETTINGS_VERSION 1
+
+enum {LATENCY_SNAP, LATENCY_QUEUE, LATENCY_ANALYSIS, LATENCY_DISPATCH, LATENCY_ACTION, LATENCY_TOTAL, LATENCY_STARTUP, LATENCY_NBSTAGES};
 
 
 typedef struct
@@ -323,6 +353,19 @@ typedef struct
     int (*function)(void* param);
 } Action;
 
+/* Where a snap was (in samples from the start of the capture) and when it went through each stage
+   (SDL_GetTicks times): the action is posted at dispatchTime, the executor starts it at startTime */
+typedef struct
+{
+    Uint32 onset,
+           position,
+           captureTime,
+           analysisTime,
+           dispatchTime,
+           startTime,
+           actionTime;
+} DetectionStamp;
+
 typedef struct
 {
     unsigned int samplingFreq,
@@ -333,17 +376,25 @@ typedef struct
     char file[MAX_PATH+1],
          launchDir[MAX_PATH+1],
          args[MAX_STRING];
+    int isLowLatency;
+    unsigned int version;
 } Settings;
 
 static HINSTANCE mainInstance;
 static HWND mainDlgWnd, runDlgWnd, optionsDlgWnd, aboutDlgWnd;
 static Settings mainSettings;
-static FMOD_SOUND *soundBuffer = NULL;
-static double *modulesTab[10] = {NULL};
-static int nbCurrentThreads = 0;
+static AudioSource *mainSource = NULL;
+static DisplayBuffer mainDisplay;
+static volatile Uint32 displayWidth = 1;
+static char recordFileName[MAX_PATH+1] = "";
+static Record mainRecord;
+static Detector mainDetector;
+static Worker mainWorker;
+static ActionQueue mainActions;
 static BOOL isAnalysing = FALSE;
 static SDL_TimerID mainTimerID = 0;
-static int isBufferReady = -1;
+static LatencyHistogram tabLatencies[LATENCY_NBSTAGES];
+static Uint32 startTime = 0;
 
 static void CenterWindow(HWND hwnd1, HWND hwnd2);
 static int CreateWndClass(WNDPROC wndProc, const char name[]);
@@ -357,6 +408,8 @@ int ToggleTaskBarIcon(int off);
 int PrintTaskbarIconMenu(void);
 Uint32 timerFunction(Uint32 interval, void *param);
 int threadFunction(void *param);
+void RunAction(void *item, void *param);
+void AddDetectionLatencies(const DetectionStamp *stamp);
 
 int DblClickDesktop(void *param);
 
@@ -372,9 +425,6 @@ int Exec(void *param);
 int WindowsTab(void *param);
 int DoNothing(void *param);
 
-static int IsNoisySnapshot(double *modules, double *noiseModules, unsigned int sampleLength_PCM, unsigned int samplingFreq);
-Uint32 DecreaseNbSnapshots(Uint32 interval, void *param);
-
 
 static Action tabActions[] =
 {
@@ -400,9 +450,14 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 {
     int numDrivers;
 
+    /* snapd -r file: logs what the detector consumes, to replay it with the batch analysis */
+    if (!strncmp(lpCmdLine, "-r ", 3))
+        strncpy(recordFileName, lpCmdLine + 3, MAX_PATH);
+
     FMOD_System_Create(&mainFMODSystem);
     FMOD_System_Init(mainFMODSystem, 1, FMOD_INIT_NORMAL, NULL);
     SDL_Init(SDL_INIT_TIMER);
+    InitDFT(DFT_WISDOM_FILE);
 
     FMOD_System_GetRecordNumDrivers(mainFMODSystem, &numDrivers);
     if (numDrivers < 0)
@@ -417,6 +472,7 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
         SaveSettings();
     }
 
+    QuitDFT(DFT_WISDOM_FILE);
     SDL_Quit();
     FMOD_System_Close(mainFMODSystem);
     FMOD_System_Release(mainFMODSystem);
@@ -565,6 +621,7 @@ BOOL CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
                     mainSettings.driverId = ComboBox_GetCurSel(GetDlgItem(optionsDlgWnd, IDCB_DRIVER));
                     mainSettings.samplingFreq = ComboBox_GetCurSel(GetDlgItem(optionsDlgWnd, IDCB_SAMPLEFREQ));
                     mainSettings.snapAction = ComboBox_GetCurSel(GetDlgItem(optionsDlgWnd, IDCB_ACTION));
+                    mainSettings.isLowLatency = Button_GetCheck(GetDlgItem(optionsDlgWnd, IDCK_LOWLATENCY)) == BST_CHECKED;
 
                     Edit_GetText(GetDlgItem(optionsDlgWnd, IDET_SAMPLELENGTH), buffer, MAX_STRING-1);
                     sampleLength = strtol(buffer, NULL, 10);
@@ -660,6 +717,7 @@ BOOL CALLBACK OptionsDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lPar
                 ComboBox_AddString(comboBoxWnd, buffer);
             }
             ComboBox_SetCurSel(comboBoxWnd, mainSettings.samplingFreq);
+            Button_SetCheck(GetDlgItem(hwndDlg, IDCK_LOWLATENCY), mainSettings.isLowLatency ? BST_CHECKED : BST_UNCHECKED);
 
             comboBoxWnd = GetDlgItem(hwndDlg, IDCB_ACTION);
             for (i=0 ; tabActions[i].function ; i++)
@@ -924,80 +982,90 @@ int PrintTaskbarIconMenu(void)
 
 Uint32 timerFunction(Uint32 interval, void *param)
 {
-    SDL_CreateThread(threadFunction, param);
+    PostWorkerTick(&mainWorker);
 
     return interval;
 }
 int threadFunction(void *param)
 {
     HWND hwnd = (HWND)param;
-    Sint8 *pcmData1, *pcmData2, *pcmData;
-    unsigned int len1, len2, recPos;
-    unsigned int sampleLength_PCM = mainSettings.sampleLength * tabFreq[mainSettings.samplingFreq] / 1000;
-    unsigned int soundBufferLength_PCM;
-    int i;
-    double *modules = NULL,
-           *noiseModules = NULL;
-
-    nbCurrentThreads++;
-
-    FMOD_Sound_GetLength(soundBuffer, &soundBufferLength_PCM, FMOD_TIMEUNIT_PCM);
-    FMOD_System_GetRecordPosition(mainFMODSystem, mainSettings.driverId, &recPos);
+    const void *pcmData1, *pcmData2;
+    unsigned int len1, len2;
+    int nbNewFrames = 0, isSnapshot = 0, isDisplayed = 0;
+    DetectionStamp stamp;
+    Uint32 tickTime = SDL_GetTicks();
 
-    pcmData = malloc(soundBufferLength_PCM);
-    memset(pcmData, 0, soundBufferLength_PCM);
-    FMOD_Sound_Lock(soundBuffer, recPos+1, soundBufferLength_PCM - (recPos+1), (void**)&pcmData1, (void**)&pcmData2, &len1, &len2);
-    memcpy(pcmData, pcmData1, len1);
-    FMOD_Sound_Unlock(soundBuffer, (void*)pcmData1, (void*)pcmData2, len1, len2);
-    if (recPos >= sampleLength_PCM)
+    if (startTime)
     {
-        FMOD_Sound_Lock(soundBuffer, 0, recPos - sampleLength_PCM, (void**)&pcmData1, (void**)&pcmData2, &len1, &len2);
-        memcpy(pcmData + soundBufferLength_PCM - (recPos+1), pcmData1, len1);
-        FMOD_Sound_Unlock(soundBuffer, (void*)pcmData1, (void*)pcmData2, len1, len2);
+        AddLatency(&tabLatencies[LATENCY_STARTUP], tickTime - startTime);
+        startTime = 0;
     }
-    noiseModules = ProcessDFT(pcmData, soundBufferLength_PCM);
 
-    memset(pcmData, 0, soundBufferLength_PCM);
-    if (recPos < sampleLength_PCM)
+    isDisplayed = IsWindowVisible(GetParent(hwnd));
+    SetDetectorFullSpectrum(&mainDetector, isDisplayed);
+    mainDetector.threshold = mainSettings.detectionThreshold;
+    if (PeekPCMRing(&mainSource->ring, &pcmData1, &len1, &pcmData2, &len2) > 0)
     {
-        recPos += soundBufferLength_PCM - sampleLength_PCM;
-        FMOD_Sound_Lock(soundBuffer, recPos, soundBufferLength_PCM - recPos, (void**)&pcmData1, (void**)&pcmData2, &len1, &len2);
-        memcpy(pcmData, pcmData1, len1);
-        FMOD_Sound_Unlock(soundBuffer, (void*)pcmData1, (void*)pcmData2, len1, len2);
-        FMOD_Sound_Lock(soundBuffer, 0, sampleLength_PCM - (soundBufferLength_PCM - recPos), (void**)&pcmData1, (void**)&pcmData2, &len1, &len2);
-        memcpy(pcmData + soundBufferLength_PCM - recPos, pcmData1, len1);
-        FMOD_Sound_Unlock(soundBuffer, (void*)pcmData1, (void*)pcmData2, len1, len2);
+        nbNewFrames = TickDetector(&mainDetector, pcmData1, len1, pcmData2, len2, &isSnapshot);
+        if (mainRecord.file)
+            WriteRecordTick(&mainRecord, pcmData1, len1, pcmData2, len2, (isSnapshot ? RECORD_SNAP : 0) | (isDisplayed ? RECORD_FULLSPECTRUM : 0));
+        SkipPCMRing(&mainSource->ring, len1 + len2);
     }
-    else
+
+    if (nbNewFrames > 0)
     {
-        recPos -= sampleLength_PCM;
-        FMOD_Sound_Lock(soundBuffer, recPos, sampleLength_PCM, (void**)&pcmData1, (void**)&pcmData2, &len1, &len2);
-        memcpy(pcmData, pcmData1, len1);
-        FMOD_Sound_Unlock(soundBuffer, (void*)pcmData1, (void*)pcmData2, len1, len2);
-    }
-    modules = ProcessDFT(pcmData, soundBufferLength_PCM);
-    free(pcmData);
+        stamp.analysisTime = SDL_GetTicks();
+        AddLatency(&tabLatencies[LATENCY_ANALYSIS], stamp.analysisTime - tickTime);
 
-    if (IsNoisySnapshot(modules, noiseModules, soundBufferLength_PCM, tabFreq[mainSettings.samplingFreq]))
-        tabActions[mainSettings.snapAction].function(NULL);
+        if (isDisplayed)
+        {
+            DecimateSpectrum(GetDisplayBack(&mainDisplay), mainDetector.stft.modules, mainDetector.stft.frameLength,
+                             mainDetector.samplingFreq, AtomicGet(&displayWidth));
+            PublishDisplay(&mainDisplay);
+        }
+    }
 
-    for (i=0 ; i < 10 && modulesTab[i] ; i++);
-    if (i < 10 && IsWindowVisible(GetParent(hwnd)))
-        modulesTab[i] = modules;
-    else free(modules);
-    free(noiseModules);
+    if (isSnapshot)
+    {
+        stamp.onset = mainDetector.lastOnset;
+        stamp.position = mainDetector.lastDetection;
+        stamp.captureTime = GetCaptureTime(mainSource, stamp.position);
+        stamp.dispatchTime = SDL_GetTicks();
+        PostAction(&mainActions, &stamp, stamp.dispatchTime);
+    }
 
-    if (IsWindowVisible(GetParent(hwnd)))
+    if (nbNewFrames > 0 && isDisplayed)
         RedrawWindow(hwnd, NULL, NULL, RDW_INVALIDATE);
 
-    nbCurrentThreads--;
     return 1;
 }
-LRESULT CALLBACK DFTWndProc (HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+
+/* Runs on the executor of mainActions, item is the DetectionStamp of the snap. Only this thread adds
+   the latencies of the detections, the analysis thread only those of the ticks. */
+void RunAction(void *item, void *param)
+{
+    DetectionStamp *stamp = item;
+
+    stamp->startTime = SDL_GetTicks();
+    tabActions[mainSettings.snapAction].function(NULL);
+    stamp->actionTime = SDL_GetTicks();
+    AddDetectionLatencies(stamp);
+}
+
+/* The time the snap took to be captured is that of the samples between its onset and the detection */
+void AddDetectionLatencies(const DetectionStamp *stamp)
 {
-    unsigned int soundBufferLength_PCM;
-    FMOD_Sound_GetLength(soundBuffer, &soundBufferLength_PCM, FMOD_TIMEUNIT_PCM);
+    Uint32 snapLength = (Uint32)((Uint64)(stamp->position - stamp->onset) * 1000 / mainDetector.samplingFreq);
+
+    AddLatency(&tabLatencies[LATENCY_SNAP], snapLength);
+    AddLatency(&tabLatencies[LATENCY_QUEUE], stamp->analysisTime - stamp->captureTime);
+    AddLatency(&tabLatencies[LATENCY_DISPATCH], stamp->startTime - stamp->dispatchTime);
+    AddLatency(&tabLatencies[LATENCY_ACTION], stamp->actionTime - stamp->startTime);
+    AddLatency(&tabLatencies[LATENCY_TOTAL], stamp->startTime - stamp->captureTime + snapLength);
+}
 
+LRESULT CALLBACK DFTWndProc (HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
     switch (msg)
     {
         case WM_PAINT:
@@ -1008,18 +1076,13 @@ LRESULT CALLBACK DFTWndProc (HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             LOGBRUSH lb;
             HGDIOBJ hPen = NULL, hPenOld;
             HBRUSH greenBrush = NULL, yellowBrush = NULL;
-            int i, j, interval;
+            int j;
+            const DisplaySpectrum *spectrum = NULL;
             double sum, modMax=0;
-            double sum1 = 0, sum2 = 0,
-                   sum3 = 0, sum4 = 0;
-            int freq1 = BAND1*soundBufferLength_PCM/tabFreq[mainSettings.samplingFreq],
-                freq2 = BAND2*soundBufferLength_PCM/tabFreq[mainSettings.samplingFreq],
-                freq3 = BAND3*soundBufferLength_PCM/tabFreq[mainSettings.samplingFreq],
-                freq4 = BAND4*soundBufferLength_PCM/tabFreq[mainSettings.samplingFreq],
-                maxFreq = tabFreq[mainSettings.samplingFreq]/2 + 1;
+            double sum1, sum2, sum3, sum4;
+            int maxFreq = tabFreq[mainSettings.samplingFreq]/2 + 1;
 
             GetClientRect(hwnd, &wndSize);
-            interval = (soundBufferLength_PCM/2+1) / wndSize.right;
             hdc = BeginPaint(hwnd, &paintst);
 
             lb.lbStyle = BS_SOLID;
@@ -1028,25 +1091,17 @@ LRESULT CALLBACK DFTWndProc (HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             hPen = ExtCreatePen(PS_COSMETIC | PS_SOLID, 1, &lb, 0, NULL);
             hPenOld = SelectObject(hdc, hPen);
 
-            if (modulesTab[0])
-            {
-                for (j=0 ; j < soundBufferLength_PCM/2+1 ; j+=interval)
-                {
-                    sum = 0;
-                    for (i=0 ; i < interval ; i++)
-                        sum += modulesTab[0][i+j] / interval;
-                    if (sum > modMax)
-                        modMax = sum;
-                }
+            /* The analysis cuts the spectrum to this width from its next tick on */
+            if (wndSize.right > 0)
+                AtomicSet(&displayWidth, wndSize.right);
 
-                for (i=0 ; i < freq1 ; i++)
-                    sum1 += modulesTab[0][i]/freq1;
-                for (; i < freq2 ; i++)
-                    sum2 += modulesTab[0][i]/(freq2-freq1);
-                for (; i < freq3 ; i++)
-                    sum3 += modulesTab[0][i]/(freq3-freq2);
-                for (; i < freq4 ; i++)
-                    sum4 += modulesTab[0][i]/(freq4-freq3);
+            if ( (spectrum = ReadDisplay(&mainDisplay)) )
+            {
+                modMax = spectrum->meanMax;
+                sum1 = spectrum->bandPowers[0];
+                sum2 = spectrum->bandPowers[1];
+                sum3 = spectrum->bandPowers[2];
+                sum4 = spectrum->bandPowers[3];
 
                 FillRect(hdc, &wndSize, GetStockObject(LTGRAY_BRUSH));
                 greenBrush = CreateSolidBrush(RGB(0,127,0));
@@ -1071,21 +1126,14 @@ LRESULT CALLBACK DFTWndProc (HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                 DeleteObject(greenBrush);
                 DeleteObject(yellowBrush);
 
-                for (j=0 ; j < soundBufferLength_PCM/2+1 ; j+=interval)
+                for (j=0 ; j < wndSize.right ; j++)
                 {
-                    sum = 0;
-                    for (i=0 ; i < interval ; i++)
-                        sum += modulesTab[0][i+j] / interval;
+                    sum = spectrum->means[(Uint32)j * spectrum->nbColumns / wndSize.right];
 
-                    MoveToEx(hdc, j/interval, wndSize.bottom, NULL);
-                    LineTo(hdc, j/interval, wndSize.bottom * (1 - sum/modMax));
+                    MoveToEx(hdc, j, wndSize.bottom, NULL);
+                    LineTo(hdc, j, wndSize.bottom * (1 - sum/modMax));
                 }
 
-                free(modulesTab[0]);
-                for (j=1 ; j < 10 ; j++)
-                    modulesTab[j-1] = modulesTab[j];
-                modulesTab[9] = NULL;
-
                 SelectObject(hdc, hPenOld);
                 DeleteObject(hPen);
                 lb.lbColor = RGB(255,0,0);
@@ -1154,14 +1202,20 @@ static int CreateWndClass(WNDPROC wndProc, const char name[])
     return RegisterClassEx (&wincl);
 }
 
+/* Files saved before the version field hold the settings up to args, and the padding which follows:
+   those are kept, and the low latency option (which the padding may overlap) is off */
 static int LoadSettings(void)
 {
     FILE *settingsFile;
 
+    mainSettings.version = 0;
     if ( (settingsFile = fopen("param.cf", "rb")) )
     {
-        if (fread(&mainSettings, 1, sizeof(Settings),settingsFile) == sizeof(Settings))
+        if (fread(&mainSettings, 1, sizeof(Settings),settingsFile) >= offsetof(Settings, isLowLatency))
         {
+            if (mainSettings.version != SETTINGS_VERSION)
+                mainSettings.isLowLatency = 0;
+            mainSettings.version = SETTINGS_VERSION;
             fclose(settingsFile);
             return 1;
         }
@@ -1175,6 +1229,8 @@ static int LoadSettings(void)
     mainSettings.snapAction = 0;
 
     mainSettings.detectionThreshold = 0.5;
+    mainSettings.isLowLatency = 0;
+    mainSettings.version = SETTINGS_VERSION;
 
     mainSettings.file[0] = '\0';
     mainSettings.launchDir[0] = '\0';
@@ -1207,21 +1263,90 @@ int StartAnalysis(void)
     HWND dftDisplayWnd = GetDlgItem(runDlgWnd, ID_DFTWND);
     static HICON iconOK = NULL;
     HWND buttonWnd = GetDlgItem(runDlgWnd, IDP_TOGGLESTATUS);
+    unsigned int hopLength, tickLength;
+    RecordHeader header;
+    char noiseFileName[MAX_PATH + sizeof(RECORD_NOISEEXT)];
 
     if (isAnalysing)
         return 0;
 
+    startTime = SDL_GetTicks();
+    InitLatencyHistogram(&tabLatencies[LATENCY_SNAP], "Snap onset to detection");
+    InitLatencyHistogram(&tabLatencies[LATENCY_QUEUE], "Capture to analysis");
+    InitLatencyHistogram(&tabLatencies[LATENCY_ANALYSIS], "Analysis (every tick)");
+    InitLatencyHistogram(&tabLatencies[LATENCY_DISPATCH], "Action queue");
+    InitLatencyHistogram(&tabLatencies[LATENCY_ACTION], "Action");
+    InitLatencyHistogram(&tabLatencies[LATENCY_TOTAL], "Snap onset to action");
+    InitLatencyHistogram(&tabLatencies[LATENCY_STARTUP], "Start to first tick");
+
     if (!iconOK)
         iconOK = LoadImage(mainInstance, "iconOK", IMAGE_ICON, 16, 16, 0);
 
     Button_Enable(buttonWnd, FALSE);
 
-    isBufferReady = -1;
-    soundBuffer = CreateSoundBuffer(soundBufferLength_PCM, tabFreq[mainSettings.samplingFreq]);
-    FMOD_System_RecordStart(mainFMODSystem, mainSettings.driverId, soundBuffer, 1);
-    Sleep(mainSettings.sampleLength - 100);
+    GetDetectorProfile(mainSettings.isLowLatency ? LOWLATENCY_BUDGET : 0, &hopLength, &tickLength);
+    if (!InitDetector(&mainDetector, tabFreq[mainSettings.samplingFreq], CAPTURE_FORMAT, mainSettings.sampleLength * tabFreq[mainSettings.samplingFreq] / 1000,
+                      hopLength * tabFreq[mainSettings.samplingFreq] / 1000, soundBufferLength_PCM, mainSettings.detectionThreshold))
+    {
+        Button_Enable(buttonWnd, TRUE);
+        return 0;
+    }
+
+    /* With the noise floor of the last run the detection is right from the first frame. The plans
+       which were just made are saved at once, not to be made again if the program does not exit well. */
+    LoadSTFTNoise(&mainDetector.stft, NOISE_FILE);
+    SaveDFTWisdom(DFT_WISDOM_FILE);
+
+    if (!InitDisplayBuffer(&mainDisplay))
+    {
+        FreeDetector(&mainDetector);
+        Button_Enable(buttonWnd, TRUE);
+        return 0;
+    }
+
+    if ( !(mainSource = OpenFMODSource(mainFMODSystem, mainSettings.driverId, tabFreq[mainSettings.samplingFreq], CAPTURE_FORMAT, soundBufferLength_PCM))
+        || !StartCapture(mainSource, soundBufferLength_PCM) )
+    {
+        CloseAudioSource(mainSource);
+        mainSource = NULL;
+        FreeDisplayBuffer(&mainDisplay);
+        FreeDetector(&mainDetector);
+        Button_Enable(buttonWnd, TRUE);
+        return 0;
+    }
+
+    /* The analysis goes on without a log if it cannot be written */
+    if (recordFileName[0])
+    {
+        header.samplingFreq = tabFreq[mainSettings.samplingFreq];
+        header.format = CAPTURE_FORMAT;
+        header.nbChannels = 1;
+        header.windowLength_PCM = mainSettings.sampleLength * tabFreq[mainSettings.samplingFreq] / 1000;
+        header.hopLength_PCM = hopLength * tabFreq[mainSettings.samplingFreq] / 1000;
+        header.bufferLength_PCM = soundBufferLength_PCM;
+        header.threshold = mainSettings.detectionThreshold;
+        CreateRecord(&mainRecord, recordFileName, &header);
+
+        strcpy(noiseFileName, recordFileName);
+        strcat(noiseFileName, RECORD_NOISEEXT);
+        remove(noiseFileName);
+        SaveSTFTNoise(&mainDetector.stft, noiseFileName);
+    }
 
-    mainTimerID = SDL_AddTimer(100, timerFunction, (void*)dftDisplayWnd);
+    /* The actions run on their own thread, not to hold up the analysis */
+    if (!StartActionQueue(&mainActions, RunAction, NULL, sizeof(DetectionStamp), ACTION_MAXQUEUE, ACTION_DEBOUNCE, 1)
+        || !StartWorker(&mainWorker, threadFunction, (void*)dftDisplayWnd, WORKER_MAXBACKLOG))
+    {
+        StopActionQueue(&mainActions);
+        CloseRecord(&mainRecord);
+        CloseAudioSource(mainSource);
+        mainSource = NULL;
+        FreeDisplayBuffer(&mainDisplay);
+        FreeDetector(&mainDetector);
+        Button_Enable(buttonWnd, TRUE);
+        return 0;
+    }
+    mainTimerID = SDL_AddTimer(tickLength, timerFunction, NULL);
 
     Static_SetIcon(GetDlgItem(runDlgWnd, IDI_STATUS), iconOK);
     Static_SetText(GetDlgItem(runDlgWnd, IDT_STATUS), "Snap Detector is working well!");
@@ -1237,6 +1362,7 @@ int StopAnalysis(void)
 {
     static HICON iconStop = NULL;
     HWND buttonWnd = GetDlgItem(runDlgWnd, IDP_TOGGLESTATUS);
+    FILE *latencyFile = NULL;
 
     if (!isAnalysing)
         return 0;
@@ -1250,12 +1376,27 @@ int StopAnalysis(void)
     {
         SDL_RemoveTimer(mainTimerID);
         mainTimerID = 0;
-        while (nbCurrentThreads > 0)
-            Sleep(10);
     }
+    StopWorker(&mainWorker);
+    StopActionQueue(&mainActions);
+    CloseRecord(&mainRecord);
+    SaveSTFTNoise(&mainDetector.stft, NOISE_FILE);
 
-    FMOD_System_RecordStop(mainFMODSystem, mainSettings.driverId);
-    FMOD_Sound_Release(soundBuffer);
+    if ( (latencyFile = fopen(LATENCY_FILE, "w")) )
+    {
+        WriteLatencyHistograms(latencyFile, tabLatencies, LATENCY_NBSTAGES);
+        fprintf(latencyFile, "\nCascade: %d of %d hops were candidates, the full analysis ran on %d of %d ticks.\n",
+                mainDetector.cascade.nbCandidates, mainDetector.cascade.nbHops, mainDetector.cascade.nbFullTests, mainDetector.cascade.nbTicks);
+        fprintf(latencyFile, "Actions: %d posted, %d run, %d coalesced, %d debounced, %d dropped.\n", mainActions.nbPosted,
+                mainActions.nbExecuted, mainActions.nbCoalesced, mainActions.nbDebounced, mainActions.nbDropped);
+        fclose(latencyFile);
+    }
+
+    CloseAudioSource(mainSource);
+    mainSource = NULL;
+    FreeDetector(&mainDetector);
+
+    FreeDisplayBuffer(&mainDisplay);
 
     Static_SetIcon(GetDlgItem(runDlgWnd, IDI_STATUS), iconStop);
     Static_SetText(GetDlgItem(runDlgWnd, IDT_STATUS), "Snap Detector is sleeping...");
@@ -1428,199 +1569,1887 @@ int DoNothing (void *param)
     return 1;
 }
 
-static int nbTotalSnapshots = 0;
-Uint32 DecreaseNbSnapshots(Uint32 interval, void *param)
-{
-    nbTotalSnapshots--;
-    return 0;
-}
-Uint32 BufferReady(Uint32 interval, void *param)
+
+
+
+#endif
+//////////////////////////////////////////////
+
+
+
+//////////////////////////////////////////////
+/* ------------- Batch mode ----------------*/
+#if (CURRENT_MODE==BATCH_MODE)
+
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include "atomics.h"
+
+#define BATCH_SAMPLELENGTH      250
+#define BATCH_TICKLENGTH        100
+#define BATCH_THRESHOLD         0.5
+#define BATCH_MAXTHREADS        64
+
+typedef struct
 {
-    isBufferReady = 1;
-    return 0;
-}
-static int IsNoisySnapshot(double *modules, double *noiseModules, unsigned int sampleLength_PCM, unsigned int samplingFreq)
+    Uint32 onset,
+           position;
+    double bandPowers[4];
+} BatchEvent;
+
+typedef struct
 {
-    int i, freq2 = BAND2*sampleLength_PCM/samplingFreq,
-        freq3 = BAND3*sampleLength_PCM/samplingFreq,
-        freq4 = BAND4*sampleLength_PCM/samplingFreq,
-        freq1 = BAND1*sampleLength_PCM/samplingFreq,
-        freqDiff = freq3 - freq2,
-        isSnapshot = 0;
-    double power4 = 0, power2 = 0, power3 = 0;
-    static Uint32 lastDetectionTime = 0;
-    unsigned int bufferLength;
+    const char *fileName;
+    unsigned int samplingFreq;
+    Uint32 nbSamples,
+           nbFrames,
+           nbOpenFrames,
+           nbTicks,
+           nbDiffs;
+    CascadeStats cascade;
+    int isOK;
+    BatchEvent *events;
+    unsigned int nbEvents,
+                 maxEvents;
+} BatchFile;
 
-    FMOD_Sound_GetLength(soundBuffer, &bufferLength, FMOD_TIMEUNIT_MS);
+typedef struct
+{
+    BatchFile *files;
+    unsigned int nbFiles,
+                 sampleLength,
+                 hopLength,
+                 tickLength,
+                 minVotes;
+    int isGated,
+        isReplay,
+        isClassified;
+    double threshold,
+           cascadeRatio;
+    volatile Uint32 nextFile;
+} BatchJob;
+
+static unsigned int GetNbCPUs(void);
+static int BatchThread(void *param);
+static int AnalyseFile(const BatchJob *job, BatchFile *file);
+static int ReplayFile(BatchFile *file);
+static int AddBatchEvent(BatchFile *file, Uint32 onset, Uint32 position, const double bandPowers[4]);
+static void WriteBatchResults(FILE *outFile, const BatchFile *files, unsigned int nbFiles, int isJSON);
+static void WriteQuotedString(FILE *outFile, const char string[], int isJSON);
+
+
+/* snapd [-t threshold] [-l window_ms] [-s hop_ms] [-i tick_ms] [-p latency_ms] [-m votes] [-g 0|1] [-c ratio] [-k 0|1] [-j threads] [-f csv|jsonl] [-o output] file.wav...
+   snapd -r 1 [-j threads] [-f csv|jsonl] [-o output] file.log...
+   Runs the detector over each file as fast as possible, one file per thread, with the same window,
+   noise buffer and tick as the live analysis.
+   -p takes the hop and the tick of the profile meeting the given latency, -s and -i set them apart.
+   The channels of a file are mixed down, unless -m is given: then each channel is analysed as one
+   microphone and a snap is detected when at least votes channels see it.
+   -g 0 transforms every frame, instead of only those the transient gate lets through.
+   -c sets the ratio to the noise floor a frame needs in band 3 for the window to be fully analysed
+   (0 analyses every window). How many hops and ticks each stage passed is summed up on stderr.
+   -k 1 decides with the learned classifier (model.h, made by snapd-train) instead of the band ratios.
+   Each snap is given with the time it started (onset) and the time it was detected, how long the
+   detections took is summed up on stderr.
+   -r 1 replays logs recorded by the live analysis (started with -r file.log) tick by tick, with the
+   settings and the noise profile (file.log.noise) they were recorded with, and tells every tick where the replay does not decide as the log. */
+int main(int argc, char *argv[])
+{
+    BatchJob job = {0};
+    SDL_Thread *tabThreads[BATCH_MAXTHREADS] = {NULL};
+    FILE *outFile = stdout;
+    unsigned int nbThreads = GetNbCPUs(), latencyBudget = 0, i, j;
+    int isJSON = 0, nbFailed = 0;
+    Uint32 time, nbFrames = 0, nbOpenFrames = 0, nbTicks = 0, nbDiffs = 0;
+    double duration = 0;
+    CascadeStats cascade = {0};
+    LatencyHistogram latency;
+
+    job.sampleLength = BATCH_SAMPLELENGTH;
+    job.tickLength = BATCH_TICKLENGTH;
+    job.threshold = BATCH_THRESHOLD;
+    job.isGated = 1;
+    job.cascadeRatio = DETECTOR_CASCADERATIO;
+
+    for (i=1 ; i < argc && argv[i][0] == '-' ; i++)
+    {
+        if (i+1 >= argc)
+        {
+            i = argc;
+            break;
+        }
+        else if (!strcmp(argv[i], "-t"))
+            job.threshold = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-l"))
+            job.sampleLength = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s"))
+            job.hopLength = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-i"))
+            job.tickLength = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-p"))
+            latencyBudget = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-m"))
+            job.minVotes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-g"))
+            job.isGated = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-c"))
+            job.cascadeRatio = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-k"))
+            job.isClassified = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-r"))
+            job.isReplay = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-j"))
+            nbThreads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-f"))
+        {
+            i++;
+            if (!strcmp(argv[i], "jsonl"))
+                isJSON = 1;
+            else if (!strcmp(argv[i], "csv"))
+                isJSON = 0;
+            else
+            {
+                i = argc;
+                break;
+            }
+        }
+        else if (!strcmp(argv[i], "-o"))
+        {
+            if ( !(outFile = fopen(argv[++i], "w")) )
+            {
+                fprintf(stderr, "Unable to create '%s'.\n", argv[i]);
+                return 1;
+            }
+        }
+        else
+        {
+            i = argc;
+            break;
+        }
+    }
 
-    if (isBufferReady < 0)
+    if (i >= argc || !job.sampleLength || !job.tickLength)
     {
-        isBufferReady = 0;
-        SDL_AddTimer(bufferLength, BufferReady, NULL);
+        fprintf(stderr, "Usage: %s [-t threshold] [-l window_ms] [-s hop_ms] [-i tick_ms] [-p latency_ms] [-m votes] [-g 0|1] [-c ratio] [-k 0|1] [-j threads] [-f csv|jsonl] [-o output] file.wav...\n"
+                        "       %s -r 1 [-j threads] [-f csv|jsonl] [-o output] file.log...\n", argv[0], argv[0]);
+        return 1;
     }
+    if (latencyBudget > 0)
+        GetDetectorProfile(latencyBudget, &job.hopLength, &job.tickLength);
+
+    job.nbFiles = argc - i;
+    if ( !(job.files = calloc(job.nbFiles, sizeof(BatchFile))) )
+        return 1;
+    for (i=0 ; i < job.nbFiles ; i++)
+        job.files[i].fileName = argv[argc - job.nbFiles + i];
+
+    if (nbThreads < 1)
+        nbThreads = 1;
+    else if (nbThreads > BATCH_MAXTHREADS)
+        nbThreads = BATCH_MAXTHREADS;
+    if (nbThreads > job.nbFiles)
+        nbThreads = job.nbFiles;
+
+    SDL_Init(0);
+    InitDFT(DFT_WISDOM_FILE);
+    time = SDL_GetTicks();
 
-    if (isBufferReady)
+    for (i=1 ; i < nbThreads ; i++)
+        tabThreads[i] = SDL_CreateThread(BatchThread, &job);
+    BatchThread(&job);
+    for (i=1 ; i < nbThreads ; i++)
     {
-        if ((int)(SDL_GetTicks() - lastDetectionTime) < TIMESPACEMIN)
-            return 0;
+        if (tabThreads[i])
+            SDL_WaitThread(tabThreads[i], NULL);
+    }
 
-        if (nbTotalSnapshots > 0)
-        {
-            for (i=freq2 ; i < freq3 ; i++)
-                noiseModules[i] = noiseModules[i+freqDiff];
-        }
+    time = SDL_GetTicks() - time;
+    WriteBatchResults(outFile, job.files, job.nbFiles, isJSON);
+    InitLatencyHistogram(&latency, "Snap onset to detection");
 
-        for (i=0 ; i < sampleLength_PCM/2+1 ; i++)
+    for (i=0 ; i < job.nbFiles ; i++)
+    {
+        if (job.files[i].isOK)
         {
-            modules[i] -= noiseModules[i];
-            if (modules[i] < 0)
-                modules[i] = 0;
+            for (j=0 ; j < job.files[i].nbEvents ; j++)
+                AddLatency(&latency, (Uint32)((Uint64)(job.files[i].events[j].position - job.files[i].events[j].onset) * 1000 / job.files[i].samplingFreq));
+            duration += (double)job.files[i].nbSamples / job.files[i].samplingFreq;
+            nbFrames += job.files[i].nbFrames;
+            nbOpenFrames += job.files[i].nbOpenFrames;
+            nbTicks += job.files[i].nbTicks;
+            nbDiffs += job.files[i].nbDiffs;
+            cascade.nbHops += job.files[i].cascade.nbHops;
+            cascade.nbCandidates += job.files[i].cascade.nbCandidates;
+            cascade.nbTicks += job.files[i].cascade.nbTicks;
+            cascade.nbFullTests += job.files[i].cascade.nbFullTests;
         }
-
-        freqDiff = freq2 - freq1;
-        for (i = freq1 ; i < freq2 ; i++)
-            power2 += modules[i]/freqDiff;
-        freqDiff = freq3 - freq2;
-        for (; i < freq3 ; i++)
-            power3 += modules[i]/freqDiff;
-        freqDiff = freq4 - freq3;
-        for (; i < freq4 ; i++)
-            power4 += modules[i]/freqDiff;
-
-        if (power3 > mainSettings.detectionThreshold
-            && power3 > mainSettings.detectionThreshold*4*power2
-            && power3 > mainSettings.detectionThreshold*8*power4)
+        else
         {
-            isSnapshot = 1;
-            lastDetectionTime = SDL_GetTicks();
+            fprintf(stderr, "Unable to analyse '%s'.\n", job.files[i].fileName);
+            nbFailed++;
         }
+        free(job.files[i].events);
     }
-    else isSnapshot = IsSnapshot(modules, sampleLength_PCM, samplingFreq);
-
-    if (isSnapshot)
+    fprintf(stderr, "%d file(s), %.1f s of sound analysed in %.2f s with %d thread(s) (x%.1f real time).\n",
+            job.nbFiles - nbFailed, duration, time/1000.0, nbThreads, time ? duration*1000/time : 0);
+    if (job.isReplay)
+        fprintf(stderr, "%d tick(s) replayed, %d decision(s) differ from the logs.\n", nbTicks, nbDiffs);
+    else if (job.isGated)
+        fprintf(stderr, "The transient gate let %.1f%% of the frames through.\n", nbFrames ? 100.0*nbOpenFrames/nbFrames : 0);
+    if (job.isReplay || job.isGated)
+        fprintf(stderr, "%.1f%% of the hops were candidates, the full analysis ran on %.1f%% of the ticks.\n",
+                cascade.nbHops ? 100.0*cascade.nbCandidates/cascade.nbHops : 0, cascade.nbTicks ? 100.0*cascade.nbFullTests/cascade.nbTicks : 0);
+    if (latency.count)
     {
-        nbTotalSnapshots++;
-        SDL_AddTimer(bufferLength, DecreaseNbSnapshots, NULL);
-        return 1;
+        fprintf(stderr, "\n");
+        WriteLatencyHistograms(stderr, &latency, 1);
     }
 
-    /*for (i=0 ; i < sampleLength_PCM/2+1 ; i++)
-        modules[i] = noiseModules[i];*/
+    free(job.files);
+    if (outFile != stdout)
+        fclose(outFile);
+    QuitDFT(DFT_WISDOM_FILE);
+    SDL_Quit();
 
-    return 0;
+    return nbFailed ? 2 : (nbDiffs ? 3 : 0);
 }
 
+static unsigned int GetNbCPUs(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
 
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
 
-
+    return n > 0 ? n : 1;
 #endif
-//////////////////////////////////////////////
-
+}
 
-static FMOD_SOUND* CreateSoundBuffer(unsigned int length, unsigned int samplingFreq)
+static int BatchThread(void *param)
 {
-    FMOD_SOUND *soundBuffer = NULL;
-    FMOD_CREATESOUNDEXINFO soundInfo = {0};
+    BatchJob *job = param;
+    Uint32 i;
 
-    soundInfo.cbsize = sizeof(FMOD_CREATESOUNDEXINFO);
-    soundInfo.length = length;
-    soundInfo.numchannels = 1;
-    soundInfo.defaultfrequency = samplingFreq;
-    soundInfo.format = FMOD_SOUND_FORMAT_PCM8;
-    FMOD_System_CreateSound(mainFMODSystem, NULL, FMOD_OPENUSER, &soundInfo, &soundBuffer);
+    while ((i = AtomicAdd(&job->nextFile, 1) - 1) < job->nbFiles)
+        job->files[i].isOK = job->isReplay ? ReplayFile(&job->files[i]) : AnalyseFile(job, &job->files[i]);
 
-    return soundBuffer;
+    return 1;
 }
 
-static double* ProcessDFT(Sint8* pcmData, unsigned int sampleLength_PCM)
+/* The file is cut in ticks as the live timer would, and the detector runs once per tick.
+   A mixed down file is a single channel for the detector. */
+static int AnalyseFile(const BatchJob *job, BatchFile *file)
 {
-    double *complexDataIn = (double*) fftw_malloc(sizeof(double) * sampleLength_PCM),
-           *modules = NULL;
-    int i;
-    fftw_complex *complexDataOut = NULL;
-    fftw_plan fftwPlan;
-
-    for (i=0 ; i < sampleLength_PCM ; i++)
-        complexDataIn[i] = pcmData[i] / 127.0;
-    complexDataOut = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * sampleLength_PCM);
-    fftwPlan = fftw_plan_dft_r2c_1d(sampleLength_PCM, complexDataIn, complexDataOut, FFTW_ESTIMATE);
-    fftw_execute(fftwPlan);
-    fftw_destroy_plan(fftwPlan);
-    fftw_free(complexDataIn);
-
-    modules = malloc(sizeof(double) * (sampleLength_PCM/2+1));
-    for (i=0 ; i < sampleLength_PCM/2+1 ; i++)
-        modules[i] = sqrt(complexDataOut[i][0]*complexDataOut[i][0] + complexDataOut[i][1]*complexDataOut[i][1]);
-    fftw_free(complexDataOut);
+    AudioSource *source = NULL;
+    MultiDetector detector;
+    Uint8 *tick = NULL;
+    unsigned int samplingFreq, frameSize, tickLength_PCM, length;
+    int n = 0;
+
+    if ( !(source = OpenWAVSource(file->fileName, 0, job->minVotes > 0)) )
+        return 0;
+
+    samplingFreq = file->samplingFreq = source->samplingFreq;
+    frameSize = GetPCMSampleSize(source->format) * source->nbChannels;
+    tickLength_PCM = job->tickLength * samplingFreq / 1000;
+    if (tickLength_PCM < 1)
+        tickLength_PCM = 1;
+
+    if ( !(tick = malloc(tickLength_PCM * frameSize)) )
+    {
+        CloseAudioSource(source);
+        return 0;
+    }
+    if (!InitMultiDetector(&detector, source->nbChannels, job->minVotes, samplingFreq, source->format, job->sampleLength * samplingFreq / 1000,
+                           job->hopLength * samplingFreq / 1000, job->sampleLength * SOUNDBUFFERLENGTH_FACTOR * samplingFreq / 1000, job->threshold))
+    {
+        free(tick);
+        CloseAudioSource(source);
+        return 0;
+    }
+    SetMultiDetectorGate(&detector, job->isGated);
+    SetMultiDetectorCascade(&detector, job->cascadeRatio);
+    SetMultiDetectorClassifier(&detector, job->isClassified);
+
+    while (n >= 0)
+    {
+        for (length=0 ; length < tickLength_PCM && (n = source->Read(source, tick + length*frameSize, tickLength_PCM - length)) > 0 ; length += n);
+
+        if (FeedMultiDetector(&detector, tick, length) > 0 && RunMultiDetector(&detector))
+            AddBatchEvent(file, detector.lastOnset, detector.nbSamples, detector.bandPowers);
+    }
 
-    return modules;
+    file->nbSamples = detector.nbSamples;
+    file->nbFrames = detector.channels[0].stft.gate.nbFrames;
+    file->nbOpenFrames = detector.channels[0].stft.gate.nbOpenFrames;
+    GetMultiDetectorCascade(&detector, &file->cascade);
+
+    FreeMultiDetector(&detector);
+    free(tick);
+    CloseAudioSource(source);
+    return 1;
 }
 
-static int IsSnapshot(double *modules, unsigned int sampleLength_PCM, unsigned int samplingFreq)
+/* The log gives the settings of the detector and every tick it ran. Time only goes by the samples
+   fed: the log is replayed as fast as it can be, and gives the same decisions whatever the speed. */
+static int ReplayFile(BatchFile *file)
 {
-    return IsSnapshotEx(modules, sampleLength_PCM, samplingFreq, NULL, NULL, NULL, NULL, NULL);
+    Record record;
+    RecordHeader header;
+    Detector detector;
+    char *noiseFileName;
+    const void *pcmData;
+    unsigned int length;
+    int flags, isSnapshot, n;
+
+    if (!OpenRecord(&record, file->fileName, &header))
+        return 0;
+    /* The live detector is mono, and so are its logs */
+    if (header.nbChannels != 1)
+    {
+        fprintf(stderr, "'%s' has %d channels, only mono logs can be replayed.\n", file->fileName, header.nbChannels);
+        CloseRecord(&record);
+        return 0;
+    }
+    if (!InitDetector(&detector, header.samplingFreq, header.format, header.windowLength_PCM, header.hopLength_PCM,
+                      header.bufferLength_PCM, header.threshold))
+    {
+        CloseRecord(&record);
+        return 0;
+    }
+    file->samplingFreq = header.samplingFreq;
+
+    if ( (noiseFileName = malloc(strlen(file->fileName) + sizeof(RECORD_NOISEEXT))) )
+    {
+        strcpy(noiseFileName, file->fileName);
+        strcat(noiseFileName, RECORD_NOISEEXT);
+        LoadSTFTNoise(&detector.stft, noiseFileName);
+        free(noiseFileName);
+    }
+
+    while ((n = ReadRecordTick(&record, &pcmData, &length, &flags)) > 0)
+    {
+        SetDetectorFullSpectrum(&detector, flags & RECORD_FULLSPECTRUM);
+        TickDetector(&detector, pcmData, length, NULL, 0, &isSnapshot);
+
+        if (isSnapshot)
+            AddBatchEvent(file, detector.lastOnset, detector.nbSamples, detector.bandPowers);
+        if (isSnapshot != !!(flags & RECORD_SNAP))
+        {
+            fprintf(stderr, "'%s', tick %d at %.3f s: snap %s.\n", file->fileName, record.nbTicks,
+                    (double)detector.nbSamples / header.samplingFreq, isSnapshot ? "on replay only" : "in the log only");
+            file->nbDiffs++;
+        }
+    }
+    if (n < 0)
+        fprintf(stderr, "'%s' is cut short after %d ticks.\n", file->fileName, record.nbTicks);
+
+    file->nbSamples = detector.nbSamples;
+    file->nbFrames = detector.stft.gate.nbFrames;
+    file->nbOpenFrames = detector.stft.gate.nbOpenFrames;
+    file->nbTicks = record.nbTicks;
+    file->cascade = detector.cascade;
+
+    FreeDetector(&detector);
+    CloseRecord(&record);
+    return 1;
 }
 
-static int IsSnapshotEx(double *modules, unsigned int sampleLength_PCM, unsigned int samplingFreq,
-                        double *sum1_out, double *sum2_out, double *sum3_out, double *sum4_out, double *sum_out)
+static int AddBatchEvent(BatchFile *file, Uint32 onset, Uint32 position, const double bandPowers[4])
 {
-    double sum1 = 0, sum2 = 0,
-           sum3 = 0, sum4 = 0,
-           sum = 0;
-    int freq1 = BAND1*sampleLength_PCM/samplingFreq,
-        freq2 = BAND2*sampleLength_PCM/samplingFreq,
-        freq3 = BAND3*sampleLength_PCM/samplingFreq,
-        freq4 = BAND4*sampleLength_PCM/samplingFreq,
-        i;
-    static Uint32 lastDetectionTime = -TIMESPACEMIN;
+    BatchEvent *events;
 
-    for (i=0 ; i < freq1 ; i++)
-        sum1 += modules[i]/freq1;
-    for (; i < freq2 ; i++)
-        sum2 += modules[i]/(freq2-freq1);
-    for (; i < freq3 ; i++)
-        sum3 += modules[i]/(freq3-freq2);
-    for (; i < freq4 ; i++)
-        sum4 += modules[i]/(freq4-freq3);
-    sum = sum1 + sum2 + sum3 + sum4;
+    if (file->nbEvents == file->maxEvents)
+    {
+        if ( !(events = realloc(file->events, sizeof(BatchEvent) * (file->maxEvents*2 + 16))) )
+            return 0;
+        file->events = events;
+        file->maxEvents = file->maxEvents*2 + 16;
+    }
 
-    if (sum_out)
-        *sum_out = sum;
-    if (sum1_out)
-        *sum1_out = sum1;
-    if (sum2_out)
-        *sum2_out = sum2;
-    if (sum3_out)
-        *sum3_out = sum3;
-    if (sum4_out)
-        *sum4_out = sum4;
+    file->events[file->nbEvents].onset = onset;
+    file->events[file->nbEvents].position = position;
+    memcpy(file->events[file->nbEvents].bandPowers, bandPowers, sizeof(file->events[file->nbEvents].bandPowers));
+    file->nbEvents++;
 
-    if ((int)(SDL_GetTicks() - lastDetectionTime) < TIMESPACEMIN)
-        return 0;
-    else if (sum3 > 0.5*sum4 && sum3 > 2*sum2)
+    return 1;
+}
+
+static void WriteBatchResults(FILE *outFile, const BatchFile *files, unsigned int nbFiles, int isJSON)
+{
+    const BatchEvent *event;
+    unsigned int i, j;
+
+    if (!isJSON)
+        fprintf(outFile, "file,onset,time,band1,band2,band3,band4\n");
+
+    for (i=0 ; i < nbFiles ; i++)
     {
-        lastDetectionTime = SDL_GetTicks();
-        //WriteOutputFile(modules, "out.txt", sampleLength_PCM, samplingFreq);
-        return 1;
+        for (j=0 ; j < files[i].nbEvents ; j++)
+        {
+            event = &files[i].events[j];
+            if (isJSON)
+            {
+                fprintf(outFile, "{\"file\": ");
+                WriteQuotedString(outFile, files[i].fileName, isJSON);
+                fprintf(outFile, ", \"onset\": %.3f, \"time\": %.3f, \"bands\": [%.6f, %.6f, %.6f, %.6f]}\n",
+                        (double)event->onset / files[i].samplingFreq, (double)event->position / files[i].samplingFreq,
+                        event->bandPowers[0], event->bandPowers[1], event->bandPowers[2], event->bandPowers[3]);
+            }
+            else
+            {
+                WriteQuotedString(outFile, files[i].fileName, isJSON);
+                fprintf(outFile, ",%.3f,%.3f,%.6f,%.6f,%.6f,%.6f\n",
+                        (double)event->onset / files[i].samplingFreq, (double)event->position / files[i].samplingFreq,
+                        event->bandPowers[0], event->bandPowers[1], event->bandPowers[2], event->bandPowers[3]);
+            }
+        }
     }
-    else return 0;
 }
 
-static int WriteOutputFile(double *modules, const char fileName[], unsigned int sampleLength_PCM, unsigned int samplingRate)
+/* JSON escapes quotes and backslashes (Windows paths) with a backslash, CSV doubles the quotes */
+static void WriteQuotedString(FILE *outFile, const char string[], int isJSON)
 {
-    FILE *outFile = NULL;
     int i;
 
-    printf("Writing results...\n");
-    if ( !(outFile = fopen(fileName, "w")) )
+    fputc('"', outFile);
+    for (i=0 ; string[i] ; i++)
     {
-        printf("Unable to create the output file. Exiting.\n");
-        return 0;
+        if (string[i] == '"')
+            fputc(isJSON ? '\\' : '"', outFile);
+        else if (string[i] == '\\' && isJSON)
+            fputc('\\', outFile);
+        fputc(string[i], outFile);
     }
-    fprintf(outFile, "Frequency - Value\n");
-    for (i=0 ; i < sampleLength_PCM/2+1 ; i++)
-        fprintf(outFile, "%d - %.6f\n", i * samplingRate/sampleLength_PCM, modules[i]);
-    fclose(outFile);
+    fputc('"', outFile);
+}
 
-    return 1;
+#endif
+//////////////////////////////////////////////
+
+
+
+//////////////////////////////////////////////
+/* ----------- Benchmark mode --------------*/
+#if (CURRENT_MODE==BENCHMARK_MODE)
+
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "atomics.h"
+#include "fixed.h"
+
+#define BENCH_MINTIME           200
+#define BENCH_TICKLENGTH        100
+#define BENCH_LENGTHSTEP        150
+#define BENCH_SNAPPERIOD        1500
+#define BENCH_NOISELEVEL        0.02
+#define BENCH_LATENCY           20
+#define BENCH_SLOWACTION        400
+#define BENCH_ACTIONTICKS       30
+#define BENCH_TICKSLACK         5000000
+#define BENCH_CHECKFREQ         22050
+#define BENCH_CHECKLENGTH       15000
+#define BENCH_CHECKTHRESHOLD    0.1
+
+/* What the time of a step is compared with (a frame, a tick or a low latency tick), and which plan of
+   the whole window it holds while it runs */
+enum {BENCH_PERFRAME, BENCH_PERTICK, BENCH_PERLOWTICK};
+enum {BENCH_NOPLAN, BENCH_RAWPLAN, BENCH_LONGPLAN};
+
+typedef struct
+{
+    unsigned int samplingFreq,
+                 sampleLength_PCM,
+                 dftLength,
+                 tickLength_PCM,
+                 lowTickLength_ms,
+                 lowTickLength_PCM,
+                 pcmLength,
+                 pcmPos;
+    double stepTime_ns;
+    Sint8 *pcmData;
+    DFTReal *modules;
+    DFTPlan *dftPlan;
+    Detector detector,
+             lowDetector;
+#ifndef DFT_FIXED
+    FixedFFT fixedFFT;
+    float *fixedPowers;
+#endif
+} BenchContext;
+
+typedef struct
+{
+    char description[50];
+    int (*function)(void *param);
+    int period,
+        plan;
+} Benchmark;
+
+static volatile Uint32 nbAllocs = 0;
+
+static double GetTime_ns(void);
+static int BenchWindowDFT(void *param);
+static int BenchConvert(void *param);
+static int BenchFrameDFT(void *param);
+static int BenchBandDFT(void *param);
+#ifndef DFT_FIXED
+static int BenchFixedFFT(void *param);
+#endif
+static int BenchBands(void *param);
+static int BenchCandidate(void *param);
+static int BenchClassifier(void *param);
+static int BenchDetection(void *param);
+static int BenchTick(void *param);
+static int BenchLowLatencyTick(void *param);
+static int InitBenchContext(BenchContext *context, unsigned int samplingFreq, unsigned int sampleLength);
+static void FreeBenchContext(BenchContext *context);
+static Uint32 RunBenchmark(const Benchmark *benchmark, BenchContext *context, unsigned int minTime_ms);
+static double CheckBandKernels(BenchContext *context);
+#ifndef DFT_FIXED
+static double CheckFixedFFT(BenchContext *context, unsigned int *nbFrames);
+#endif
+static void SlowAction(void *item, void *param);
+static double RunActionTicks(BenchContext *context, ActionQueue *queue, unsigned int *nbQueued);
+static int CheckActionQueue(void);
+static int CheckRedetection(void);
+
+
+static Benchmark tabBenchmarks[] =
+{
+    { "DFT (raw win.)", BenchWindowDFT, BENCH_PERTICK, BENCH_RAWPLAN },
+    { "DFT (window)", BenchWindowDFT, BENCH_PERTICK, BENCH_LONGPLAN },
+    { "Convert (frame)", BenchConvert, BENCH_PERFRAME, BENCH_NOPLAN },
+    { "DFT (frame)", BenchFrameDFT, BENCH_PERFRAME, BENCH_NOPLAN },
+    { "DFT (bands)", BenchBandDFT, BENCH_PERFRAME, BENCH_NOPLAN },
+#ifndef DFT_FIXED
+    { "Q15 FFT (frame)", BenchFixedFFT, BENCH_PERFRAME, BENCH_NOPLAN },
+#endif
+    { "IsSnapshotEx", BenchBands, BENCH_PERTICK, BENCH_NOPLAN },
+    { "Cascade (hop)", BenchCandidate, BENCH_PERFRAME, BENCH_NOPLAN },
+    { "Classify (hop)", BenchClassifier, BENCH_PERFRAME, BENCH_NOPLAN },
+    { "Full analysis", BenchDetection, BENCH_PERTICK, BENCH_NOPLAN },
+    { "Full tick", BenchTick, BENCH_PERTICK, BENCH_NOPLAN },
+    { "Low-lat. tick", BenchLowLatencyTick, BENCH_PERLOWTICK, BENCH_NOPLAN },
+    { "", NULL, 0, 0 }
+};
+
+/* Heap allocations are only counted when linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc */
+#ifdef BENCH_COUNTALLOCS
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t nb, size_t size);
+void* __real_realloc(void *ptr, size_t size);
+
+void* __wrap_malloc(size_t size)
+{
+    AtomicAdd(&nbAllocs, 1);
+    return __real_malloc(size);
 }
+
+void* __wrap_calloc(size_t nb, size_t size)
+{
+    AtomicAdd(&nbAllocs, 1);
+    return __real_calloc(nb, size);
+}
+
+void* __wrap_realloc(void *ptr, size_t size)
+{
+    AtomicAdd(&nbAllocs, 1);
+    return __real_realloc(ptr, size);
+}
+#endif
+
+
+/* snapd-bench [min_time_ms [length_step_ms]]
+   For every sampling frequency and window length (every length_step_ms, 1 goes through all those the
+   options allow), times each step of the analysis.
+   A frame is one call: one tick of BENCH_TICKLENGTH ms for the per-tick steps, one STFT frame for
+   the others. The real time factor is the length of sound a frame stands for over its cost.
+   The low-latency tick is that of the BENCH_LATENCY ms profile, with overlapping frames.
+   The whole window is transformed over the nearest length FFTW is fast for (GetDFTLength), the raw
+   window over its exact number of samples, as it was before: the speedup of the first is summed up.
+   Unless the program is built with it (DFT_FIXED), the Q15 fixed point transform is timed next to the
+   DFT and its band powers are compared with those of the DFT over every frame of the sound.
+   The first stage of the detection cascade is timed on one frame, the second (the full analysis) on
+   the window, or the learned classifier on one frame (its features and score). How often each stage
+   ran during the full ticks is summed up after them.
+   Counting the allocations (BENCH_COUNTALLOCS) also checks that no step allocates anything once
+   warmed up: the analysis must run without touching the heap, the exit code is 1 otherwise.
+   Last, the analysis is ticked with an action posted at every tick which takes BENCH_SLOWACTION ms,
+   through the action queue of the final mode: the actions must run without slowing the ticks down,
+   the exit code is 2 otherwise. A snap may not be detected twice either, whatever the window (the exit
+   code is 3 otherwise). */
+int main(int argc, char *argv[])
+{
+    unsigned int tabFreq[] = {11025, 22050, 44100, 48000},
+                 minTime_ms = BENCH_MINTIME,
+                 lengthStep = BENCH_LENGTHSTEP,
+                 sampleLength, i, j,
+                 nbAllocating = 0;
+    int isActionQueueOK, isRedetectionOK;
+    BenchContext context;
+    double error, longTime_ns, rawTime_ns;
+#ifndef DFT_FIXED
+    unsigned int nbFrames;
+#endif
+
+    if (argc > 1 && atoi(argv[1]) > 0)
+        minTime_ms = atoi(argv[1]);
+    if (argc > 2 && atoi(argv[2]) > 0)
+        lengthStep = atoi(argv[2]);
+
+    InitDFT(DFT_WISDOM_FILE);
+    printf("Band kernels: %s\n", GetBandKernelsName());
+#ifdef DFT_FIXED
+    printf("Transform: Q15 fixed point\n");
+#endif
+
+#ifdef BENCH_COUNTALLOCS
+    printf("%-6s %-6s %-14s %12s %8s %10s\n", "Freq", "Length", "Step", "ns/frame", "allocs", "x realtime");
+#else
+    printf("%-6s %-6s %-14s %12s %8s %10s\n", "Freq", "Length", "Step", "ns/frame", "(allocs)", "x realtime");
+#endif
+
+    for (i=0 ; i < sizeof(tabFreq)/sizeof(tabFreq[0]) ; i++)
+    {
+        for (sampleLength = SAMPLELENGTH_MIN ; sampleLength <= SAMPLELENGTH_MAX ; sampleLength += lengthStep)
+        {
+            if (!InitBenchContext(&context, tabFreq[i], sampleLength))
+            {
+                printf("Unable to set up the benchmark for %d Hz, %d ms.\n", tabFreq[i], sampleLength);
+                continue;
+            }
+
+            for (j=0, longTime_ns=0, rawTime_ns=0 ; tabBenchmarks[j].function ; j++)
+            {
+                printf("%-6d %-6d ", tabFreq[i], sampleLength);
+                if (RunBenchmark(&tabBenchmarks[j], &context, minTime_ms) > 0)
+                    nbAllocating++;
+
+                if (tabBenchmarks[j].plan == BENCH_LONGPLAN)
+                    longTime_ns = context.stepTime_ns;
+                else if (tabBenchmarks[j].plan == BENCH_RAWPLAN)
+                    rawTime_ns = context.stepTime_ns;
+            }
+            printf("%-6d %-6d Cascade: %.1f%% of the hops were candidates, the full analysis ran on %.1f%% of the ticks\n",
+                   tabFreq[i], sampleLength, context.detector.cascade.nbHops ? 100.0*context.detector.cascade.nbCandidates/context.detector.cascade.nbHops : 0,
+                   context.detector.cascade.nbTicks ? 100.0*context.detector.cascade.nbFullTests/context.detector.cascade.nbTicks : 0);
+            if (longTime_ns > 0)
+                printf("%-6d %-6d Window of %d samples transformed over %d: x%.2f\n", tabFreq[i], sampleLength,
+                       context.sampleLength_PCM, context.dftLength, rawTime_ns / longTime_ns);
+
+            if ((error = CheckBandKernels(&context)) > BANDS_TOLERANCE)
+                printf("%-6d %-6d %s kernels differ from the scalar ones by %g\n", tabFreq[i], sampleLength, GetBandKernelsName(), error);
+#ifndef DFT_FIXED
+            error = CheckFixedFFT(&context, &nbFrames);
+            printf("%-6d %-6d Q15 FFT (%s): band powers within %.3f%% of the DFT over %d frames\n", tabFreq[i], sampleLength,
+                   GetFixedFFTKernelName(), 100*error, nbFrames);
+#endif
+
+            FreeBenchContext(&context);
+        }
+    }
+
+    isActionQueueOK = CheckActionQueue();
+    isRedetectionOK = CheckRedetection();
+    QuitDFT(DFT_WISDOM_FILE);
+
+#ifdef BENCH_COUNTALLOCS
+    if (nbAllocating > 0)
+    {
+        printf("%d step(s) allocated memory in steady state.\n", nbAllocating);
+        return 1;
+    }
+#endif
+    if (!isActionQueueOK)
+        return 2;
+    return isRedetectionOK ? 0 : 3;
+}
+
+static double GetTime_ns(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return counter.QuadPart * 1e9 / frequency.QuadPart;
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+#endif
+}
+
+/* The whole window, over the plan RunBenchmark holds: that of its exact length or the longer one */
+static int BenchWindowDFT(void *param)
+{
+    BenchContext *context = param;
+
+    ProcessDFT(context->dftPlan, context->pcmData, context->sampleLength_PCM, PCM_FORMAT_PCM8, context->modules);
+    return 1;
+}
+
+static int BenchConvert(void *param)
+{
+    BenchContext *context = param;
+    STFT *stft = &context->detector.stft;
+    DFTPlan *dftPlan;
+
+    if ( !(dftPlan = AcquireDFTPlan(stft->frameLength)) )
+        return 0;
+    ConvertPCM(dftPlan->dataIn, context->pcmData, stft->frameLength, PCM_FORMAT_PCM8, dftPlan->window);
+    ReleaseDFTPlan(dftPlan);
+    return 1;
+}
+
+static int BenchFrameDFT(void *param)
+{
+    BenchContext *context = param;
+    STFT *stft = &context->detector.stft;
+    DFTPlan *dftPlan;
+
+    if ( !(dftPlan = AcquireDFTPlan(stft->frameLength)) )
+        return 0;
+    ProcessDFTPower(dftPlan, context->pcmData, stft->frameLength, PCM_FORMAT_PCM8, NULL, 0);
+    ReleaseDFTPlan(dftPlan);
+    return 1;
+}
+
+static int BenchBandDFT(void *param)
+{
+    BenchContext *context = param;
+    STFT *stft = &context->detector.stft;
+    DFTPlan *dftPlan;
+
+    if ( !(dftPlan = AcquireDFTPlan(stft->frameLength)) )
+        return 0;
+    ProcessDFTPower(dftPlan, context->pcmData, stft->frameLength, PCM_FORMAT_PCM8, NULL, context->detector.nbBandBins);
+    ReleaseDFTPlan(dftPlan);
+    return 1;
+}
+
+#ifndef DFT_FIXED
+static int BenchFixedFFT(void *param)
+{
+    BenchContext *context = param;
+
+    ProcessFixedFFTPower(&context->fixedFFT, context->pcmData, context->fixedFFT.length, PCM_FORMAT_PCM8, 0, 1, context->fixedPowers, 0);
+    return 1;
+}
+#endif
+
+static int BenchBands(void *param)
+{
+    BenchContext *context = param;
+
+    return IsSnapshotEx(context->modules, context->dftLength, context->samplingFreq, NULL, NULL, NULL, NULL, NULL);
+}
+
+static int BenchCandidate(void *param)
+{
+    BenchContext *context = param;
+
+    return IsDetectorCandidate(&context->detector, context->detector.stft.nbFrames - 1);
+}
+
+static int BenchClassifier(void *param)
+{
+    BenchContext *context = param;
+    float features[FEATURES_SIZE];
+
+    GetDetectorFeatures(&context->detector, context->detector.stft.nbFrames - 1, features);
+    return ScoreFeatures(features) > 0;
+}
+
+static int BenchDetection(void *param)
+{
+    BenchContext *context = param;
+
+    return TestDetectorWindow(&context->detector);
+}
+
+static int BenchTick(void *param)
+{
+    BenchContext *context = param;
+
+    if (context->pcmPos + context->tickLength_PCM > context->pcmLength)
+        context->pcmPos = 0;
+    FeedDetector(&context->detector, context->pcmData + context->pcmPos, context->tickLength_PCM);
+    context->pcmPos += context->tickLength_PCM;
+
+    return RunDetector(&context->detector);
+}
+
+static int BenchLowLatencyTick(void *param)
+{
+    BenchContext *context = param;
+
+    if (context->pcmPos + context->lowTickLength_PCM > context->pcmLength)
+        context->pcmPos = 0;
+    FeedDetector(&context->lowDetector, context->pcmData + context->pcmPos, context->lowTickLength_PCM);
+    context->pcmPos += context->lowTickLength_PCM;
+
+    return RunDetector(&context->lowDetector);
+}
+
+/* The sound is a synthetic snap every BENCH_SNAPPERIOD ms over light noise, and the detector is fed
+   a whole noise buffer first so that every step runs as in steady state */
+static int InitBenchContext(BenchContext *context, unsigned int samplingFreq, unsigned int sampleLength)
+{
+    AudioSource *source = NULL;
+    unsigned int bufferLength_PCM = sampleLength * SOUNDBUFFERLENGTH_FACTOR * samplingFreq / 1000,
+                 hopLength;
+    int n;
+
+    memset(context, 0, sizeof(BenchContext));
+    context->samplingFreq = samplingFreq;
+    context->sampleLength_PCM = sampleLength * samplingFreq / 1000;
+    context->dftLength = GetDFTLength(context->sampleLength_PCM);
+    context->tickLength_PCM = BENCH_TICKLENGTH * samplingFreq / 1000;
+    GetDetectorProfile(BENCH_LATENCY, &hopLength, &context->lowTickLength_ms);
+    context->lowTickLength_PCM = context->lowTickLength_ms * samplingFreq / 1000;
+    context->pcmLength = bufferLength_PCM + context->sampleLength_PCM;
+
+    if ( !(context->pcmData = malloc(context->pcmLength))
+        || !(context->modules = malloc(sizeof(DFTReal) * ((context->dftLength > context->sampleLength_PCM ? context->dftLength : context->sampleLength_PCM)/2+1)))
+        || !(source = OpenSyntheticSource(samplingFreq, BENCH_SNAPPERIOD, BENCH_NOISELEVEL, 0, 0)) )
+    {
+        FreeBenchContext(context);
+        return 0;
+    }
+
+    for (context->pcmPos = 0 ; context->pcmPos < context->pcmLength ; context->pcmPos += n)
+    {
+        if ((n = source->Read(source, context->pcmData + context->pcmPos, context->pcmLength - context->pcmPos)) <= 0)
+            break;
+    }
+    CloseAudioSource(source);
+
+    if (!InitDetector(&context->detector, samplingFreq, PCM_FORMAT_PCM8, context->sampleLength_PCM, 0, bufferLength_PCM, 0.5)
+        || !InitDetector(&context->lowDetector, samplingFreq, PCM_FORMAT_PCM8, context->sampleLength_PCM, hopLength * samplingFreq / 1000, bufferLength_PCM, 0.5)
+        || !(context->dftPlan = AcquireDFTPlan(context->dftLength)))
+    {
+        FreeBenchContext(context);
+        return 0;
+    }
+    ReleaseDFTPlan(context->dftPlan);
+
+#ifndef DFT_FIXED
+    if (!InitFixedFFT(&context->fixedFFT, context->detector.stft.frameLength)
+        || !(context->fixedPowers = malloc(sizeof(float) * context->detector.stft.nbBins)))
+    {
+        FreeBenchContext(context);
+        return 0;
+    }
+#endif
+
+    FeedDetector(&context->detector, context->pcmData, context->pcmLength);
+    FeedDetector(&context->lowDetector, context->pcmData, context->pcmLength);
+    context->pcmPos = 0;
+    return 1;
+}
+
+static void FreeBenchContext(BenchContext *context)
+{
+    FreeDetector(&context->detector);
+    FreeDetector(&context->lowDetector);
+    free(context->pcmData);
+    free(context->modules);
+#ifndef DFT_FIXED
+    FreeFixedFFT(&context->fixedFFT);
+    free(context->fixedPowers);
+#endif
+    memset(context, 0, sizeof(BenchContext));
+}
+
+/* The plan of the long transform is held during the whole run, as the old analysis thread did.
+   Gives the number of allocations made once the step was warmed up by a first call. */
+static Uint32 RunBenchmark(const Benchmark *benchmark, BenchContext *context, unsigned int minTime_ms)
+{
+    double start, elapsed = 0, frameDuration;
+    Uint32 nbFrames = 0, allocs;
+
+    context->stepTime_ns = 0;
+    if (benchmark->plan != BENCH_NOPLAN
+        && !(context->dftPlan = AcquireDFTPlan(benchmark->plan == BENCH_LONGPLAN ? context->dftLength : context->sampleLength_PCM)))
+    {
+        printf("%-14s (no plan)\n", benchmark->description);
+        return 0;
+    }
+
+    benchmark->function(context);
+    allocs = AtomicGet(&nbAllocs);
+    start = GetTime_ns();
+
+    do
+    {
+        benchmark->function(context);
+        nbFrames++;
+        if ((nbFrames & 15) == 0)
+            elapsed = GetTime_ns() - start;
+    } while (elapsed < minTime_ms * 1e6);
+
+    elapsed = GetTime_ns() - start;
+    allocs = AtomicGet(&nbAllocs) - allocs;
+
+    if (benchmark->plan != BENCH_NOPLAN)
+        ReleaseDFTPlan(context->dftPlan);
+    context->stepTime_ns = elapsed / nbFrames;
+
+    if (benchmark->period == BENCH_PERLOWTICK)
+        frameDuration = context->lowTickLength_ms * 1e6;
+    else if (benchmark->period == BENCH_PERTICK)
+        frameDuration = BENCH_TICKLENGTH * 1e6;
+    else frameDuration = context->detector.stft.frameLength * 1e9 / context->samplingFreq;
+
+    printf("%-14s %12.0f %8.2f %10.1f\n", benchmark->description, elapsed / nbFrames,
+           (double)allocs / nbFrames, frameDuration * nbFrames / elapsed);
+    return allocs;
+}
+
+static void SlowAction(void *item, void *param)
+{
+    SDL_Delay(BENCH_SLOWACTION);
+}
+
+/* Longest of BENCH_ACTIONTICKS ticks, paced as live ones. With a queue, a detection is posted at every
+   tick, ACTION_DEBOUNCE/2 ms apart: every other one is debounced, the others still come twice as fast as
+   the actions run. */
+static double RunActionTicks(BenchContext *context, ActionQueue *queue, unsigned int *nbQueued)
+{
+    double start, end, maxTick = 0;
+    unsigned int i;
+
+    for (i=0 ; i < BENCH_ACTIONTICKS ; i++)
+    {
+        start = GetTime_ns();
+        BenchTick(context);
+        if (queue)
+            *nbQueued += PostAction(queue, &i, i*ACTION_DEBOUNCE/2);
+        end = GetTime_ns();
+
+        if (end - start > maxTick)
+            maxTick = end - start;
+        SDL_Delay(BENCH_TICKLENGTH);
+    }
+
+    return maxTick;
+}
+
+/* The queue is set up as in the final mode. The ticks are timed without any action first, then with the
+   slow one: the actions must all have run once the queue is drained, some requests must have been
+   coalesced, and the longest tick may be at most twice the longest idle one, give or take BENCH_TICKSLACK
+   ns of scheduling. An action run on the analysis thread would add BENCH_SLOWACTION ms to a tick. */
+static int CheckActionQueue(void)
+{
+    BenchContext context;
+    ActionQueue queue;
+    double maxIdleTick, maxTick;
+    unsigned int nbQueued = 0, wait;
+    int isOK;
+
+    if (!InitBenchContext(&context, 22050, SAMPLELENGTH_MIN))
+        return 0;
+    if (!StartActionQueue(&queue, SlowAction, NULL, sizeof(unsigned int), ACTION_MAXQUEUE, ACTION_DEBOUNCE, 1))
+    {
+        FreeBenchContext(&context);
+        return 0;
+    }
+
+    maxIdleTick = RunActionTicks(&context, NULL, NULL);
+    maxTick = RunActionTicks(&context, &queue, &nbQueued);
+    for (wait = 0 ; AtomicGet(&queue.nbExecuted) < nbQueued && wait < (ACTION_MAXQUEUE+1)*BENCH_SLOWACTION ; wait += BENCH_TICKLENGTH)
+        SDL_Delay(BENCH_TICKLENGTH);
+
+    StopActionQueue(&queue);
+    FreeBenchContext(&context);
+
+    isOK = queue.nbExecuted > 0 && queue.nbExecuted == nbQueued && queue.nbCoalesced > 0 && maxTick < 2*maxIdleTick + BENCH_TICKSLACK;
+    printf("Action queue: longest of %d ticks %.0f ns, %.0f ns with a %d ms action posted at every tick "
+           "(%d posted, %d run, %d coalesced, %d debounced, %d dropped): %s\n", BENCH_ACTIONTICKS, maxIdleTick, maxTick,
+           BENCH_SLOWACTION, queue.nbPosted, queue.nbExecuted, queue.nbCoalesced, queue.nbDebounced, queue.nbDropped,
+           isOK ? "OK" : "FAILED");
+    return isOK;
+}
+
+/* The longest window, with the cascade and the gate off (as with the spectrum displayed, or -c 0 -g 0 in
+   batch mode): nothing then keeps the full analysis from running on a window which still holds the last
+   snap detected. Each synthetic snap must be detected once at most, and no two detections may share
+   their onset. */
+static int CheckRedetection(void)
+{
+    AudioSource *source;
+    Detector detector;
+    Uint8 tick[BENCH_TICKLENGTH * BENCH_CHECKFREQ / 1000];
+    unsigned int nbSnaps = BENCH_CHECKLENGTH / BENCH_SNAPPERIOD, nbDetections = 0, nbRepeated = 0;
+    Uint32 lastOnset = 0;
+    int n, isSnapshot, isOK;
+
+    if ( !(source = OpenSyntheticSource(BENCH_CHECKFREQ, BENCH_SNAPPERIOD, BENCH_NOISELEVEL, BENCH_CHECKLENGTH, 0)) )
+        return 0;
+    if (!InitDetector(&detector, BENCH_CHECKFREQ, PCM_FORMAT_PCM8, SAMPLELENGTH_MAX * BENCH_CHECKFREQ / 1000, 0,
+                      SAMPLELENGTH_MAX * SOUNDBUFFERLENGTH_FACTOR * BENCH_CHECKFREQ / 1000, BENCH_CHECKTHRESHOLD))
+    {
+        CloseAudioSource(source);
+        return 0;
+    }
+    SetDetectorFullSpectrum(&detector, 1);
+    detector.cascadeRatio = 0;
+
+    while ((n = source->Read(source, tick, sizeof(tick))) > 0)
+    {
+        TickDetector(&detector, tick, n, NULL, 0, &isSnapshot);
+        if (isSnapshot)
+        {
+            nbRepeated += nbDetections > 0 && detector.lastOnset == lastOnset;
+            lastOnset = detector.lastOnset;
+            nbDetections++;
+        }
+    }
+
+    FreeDetector(&detector);
+    CloseAudioSource(source);
+
+    isOK = nbDetections > 0 && nbDetections <= nbSnaps && !nbRepeated;
+    printf("Repeated detections: %d snaps, %d detections over a %d ms window with the cascade and the gate off, "
+           "%d on an onset already detected: %s\n", nbSnaps, nbDetections, SAMPLELENGTH_MAX, nbRepeated, isOK ? "OK" : "FAILED");
+    return isOK;
+}
+
+/* Largest relative difference between the scalar and the selected kernels, on the magnitudes of the
+   whole window and on its band powers */
+static double CheckBandKernels(BenchContext *context)
+{
+    unsigned int i, nbBins = context->dftLength/2+1;
+    DFTReal *modules = NULL;
+    double bandPowers[4], scalarBandPowers[4],
+           error = 0, difference;
+
+    if ( !(modules = malloc(sizeof(DFTReal) * nbBins)) || !(context->dftPlan = AcquireDFTPlan(context->dftLength)) )
+    {
+        free(modules);
+        return 0;
+    }
+
+    SelectBandKernels(BANDS_SCALAR);
+    ProcessDFT(context->dftPlan, context->pcmData, context->sampleLength_PCM, PCM_FORMAT_PCM8, modules);
+    GetBandPowers(modules, context->dftLength, context->samplingFreq, scalarBandPowers);
+    SelectBandKernels(BANDS_AVX512);
+    ProcessDFT(context->dftPlan, context->pcmData, context->sampleLength_PCM, PCM_FORMAT_PCM8, context->modules);
+    GetBandPowers(context->modules, context->dftLength, context->samplingFreq, bandPowers);
+    ReleaseDFTPlan(context->dftPlan);
+
+    for (i=0 ; i < nbBins ; i++)
+    {
+        if (modules[i] > 0 && (difference = fabs(context->modules[i] - modules[i]) / modules[i]) > error)
+            error = difference;
+    }
+    for (i=0 ; i < 4 ; i++)
+    {
+        if (scalarBandPowers[i] > 0 && (difference = fabs(bandPowers[i] - scalarBandPowers[i]) / scalarBandPowers[i]) > error)
+            error = difference;
+    }
+
+    free(modules);
+    return error;
+}
+
+#ifndef DFT_FIXED
+/* Largest difference between the band powers of the Q15 transform and those of the DFT, over every frame
+   of the sound, relatively to the power of all the bands of the frame: the decision only looks at their ratios */
+static double CheckFixedFFT(BenchContext *context, unsigned int *nbFrames)
+{
+    STFT *stft = &context->detector.stft;
+    unsigned int tabBands[] = {0, BAND1, BAND2, BAND3, BAND4},
+                 pos, i, j, from, to;
+    DFTPlan *dftPlan;
+    double error = 0, difference, total, tabDifferences[4], band, fixedBand;
+
+    *nbFrames = 0;
+    if ( !(dftPlan = AcquireDFTPlan(stft->frameLength)) )
+        return 0;
+
+    for (pos=0 ; pos + stft->frameLength <= context->pcmLength ; pos += stft->frameLength)
+    {
+        ProcessDFTPower(dftPlan, context->pcmData + pos, stft->frameLength, PCM_FORMAT_PCM8, context->modules, 0);
+        ProcessFixedFFTPower(&context->fixedFFT, context->pcmData + pos, stft->frameLength, PCM_FORMAT_PCM8, 0, 1, context->fixedPowers, 0);
+
+        for (i=0, total=0 ; i < 4 ; i++)
+        {
+            from = tabBands[i]*stft->frameLength/context->samplingFreq;
+            to = tabBands[i+1]*stft->frameLength/context->samplingFreq;
+            for (j=from, band=0, fixedBand=0 ; j < to ; j++)
+            {
+                band += context->modules[j];
+                fixedBand += context->fixedPowers[j];
+            }
+            tabDifferences[i] = fabs(fixedBand - band);
+            total += band;
+        }
+        for (i=0 ; i < 4 && total > 0 ; i++)
+        {
+            if ((difference = tabDifferences[i] / total) > error)
+                error = difference;
+        }
+        (*nbFrames)++;
+    }
+
+    ReleaseDFTPlan(dftPlan);
+    return error;
+}
+#endif
+
+#endif
+//////////////////////////////////////////////
+
+
+
+//////////////////////////////////////////////
+/* ------------ Training mode --------------*/
+#if (CURRENT_MODE==TRAINING_MODE)
+
+#include <string.h>
+
+#define TRAINING_SAMPLELENGTH   250
+#define TRAINING_TICKLENGTH     100
+#define TRAINING_THRESHOLD      0.5
+#define TRAINING_LABELEXT       ".labels"
+#define TRAINING_SNAPLENGTH_MS  10
+#define TRAINING_TAILLENGTH_MS  150
+#define TRAINING_NBITERATIONS   3000
+#define TRAINING_RATE           0.5
+#define TRAINING_L2             1e-3
+
+typedef struct
+{
+    float features[FEATURES_SIZE];
+    int isSnap;
+} TrainingFrame;
+
+typedef struct
+{
+    TrainingFrame *frames;
+    unsigned int nbFrames,
+                 maxFrames,
+                 nbSnaps;
+} TrainingSet;
+
+static int LoadLabels(const char fileName[], unsigned int samplingFreq, Uint32 **onsets, unsigned int *nbOnsets);
+static int AddTrainingFrames(TrainingSet *set, const char fileName[], unsigned int sampleLength, unsigned int tickLength, double cascadeRatio);
+static void TrainClassifier(const TrainingSet *set, double means[FEATURES_SIZE], double scales[FEATURES_SIZE], double weights[FEATURES_SIZE], double *bias);
+static int WriteModel(const char fileName[], const TrainingSet *set, unsigned int nbFiles, const double means[FEATURES_SIZE],
+                      const double scales[FEATURES_SIZE], const double weights[FEATURES_SIZE], double bias);
+static int CheckModel(const char fileName[], const double means[FEATURES_SIZE], const double scales[FEATURES_SIZE], const double weights[FEATURES_SIZE]);
+
+
+/* snapd-train [-l window_ms] [-i tick_ms] [-c ratio] [-o model.h] file.wav...
+   Trains the classifier of the detection (ScoreFeatures) over a labeled corpus, and writes its tables
+   as a header to build the detector with.
+   The snaps of file.wav are listed in file.wav.labels, as the time (in s) they start, one per line.
+   Each file is run through the detector as the batch mode would, and each frame which passes the first
+   stage of the cascade gives its features: a frame is a snap if it holds the first TRAINING_SNAPLENGTH_MS
+   of one, the frames in the TRAINING_TAILLENGTH_MS which follow are left out (they are neither).
+   The classifier is a logistic regression over the standardized features, the snaps weighing as much
+   as all the other frames together. How it does over the corpus itself is summed up on stderr.
+   The header is read back once written: the exit code is 3 if it would not give the model trained. */
+int main(int argc, char *argv[])
+{
+    TrainingSet set = {0};
+    const char *modelFileName = "model.h";
+    unsigned int sampleLength = TRAINING_SAMPLELENGTH,
+                 tickLength = TRAINING_TICKLENGTH,
+                 nbFiles = 0, nbFound = 0, nbFalse = 0, i, k;
+    double cascadeRatio = DETECTOR_CASCADERATIO,
+           means[FEATURES_SIZE], scales[FEATURES_SIZE], weights[FEATURES_SIZE], bias, score;
+
+    for (i=1 ; i < argc && argv[i][0] == '-' ; i++)
+    {
+        if (i+1 >= argc)
+        {
+            i = argc;
+            break;
+        }
+        else if (!strcmp(argv[i], "-l"))
+            sampleLength = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-i"))
+            tickLength = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-c"))
+            cascadeRatio = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-o"))
+            modelFileName = argv[++i];
+        else
+        {
+            i = argc;
+            break;
+        }
+    }
+
+    if (i >= argc || !sampleLength || !tickLength)
+    {
+        fprintf(stderr, "Usage: %s [-l window_ms] [-i tick_ms] [-c ratio] [-o model.h] file.wav...\n", argv[0]);
+        return 1;
+    }
+
+    SDL_Init(0);
+    InitDFT(DFT_WISDOM_FILE);
+
+    for ( ; i < argc ; i++)
+    {
+        if (AddTrainingFrames(&set, argv[i], sampleLength, tickLength, cascadeRatio))
+            nbFiles++;
+        else fprintf(stderr, "Unable to read '%s' or its labels.\n", argv[i]);
+    }
+
+    QuitDFT(DFT_WISDOM_FILE);
+    SDL_Quit();
+
+    fprintf(stderr, "%d file(s): %d snap frame(s) and %d other candidate frame(s).\n", nbFiles, set.nbSnaps, set.nbFrames - set.nbSnaps);
+    if (!set.nbSnaps || set.nbSnaps == set.nbFrames)
+    {
+        fprintf(stderr, "Both snaps and other frames are needed to train the classifier.\n");
+        free(set.frames);
+        return 2;
+    }
+
+    TrainClassifier(&set, means, scales, weights, &bias);
+
+    for (i=0 ; i < set.nbFrames ; i++)
+    {
+        for (k=0, score=bias ; k < FEATURES_SIZE ; k++)
+            score += weights[k] * (set.frames[i].features[k] - means[k]) * scales[k];
+        if (score > 0)
+        {
+            nbFound += set.frames[i].isSnap;
+            nbFalse += !set.frames[i].isSnap;
+        }
+    }
+    fprintf(stderr, "Over the corpus: %d of %d snap frame(s) found, %d false alarm(s) out of %d frame(s).\n",
+            nbFound, set.nbSnaps, nbFalse, set.nbFrames - set.nbSnaps);
+
+    if (!WriteModel(modelFileName, &set, nbFiles, means, scales, weights, bias))
+    {
+        fprintf(stderr, "Unable to create '%s'.\n", modelFileName);
+        free(set.frames);
+        return 1;
+    }
+    if (!CheckModel(modelFileName, means, scales, weights))
+    {
+        fprintf(stderr, "'%s' does not read back as the model trained.\n", modelFileName);
+        free(set.frames);
+        return 3;
+    }
+
+    free(set.frames);
+    return 0;
+}
+
+/* The onsets, in samples, sorted as they are in the file */
+static int LoadLabels(const char fileName[], unsigned int samplingFreq, Uint32 **onsets, unsigned int *nbOnsets)
+{
+    FILE *labelFile;
+    char *labelFileName;
+    Uint32 *newOnsets;
+    unsigned int maxOnsets = 0;
+    double time;
+
+    *onsets = NULL;
+    *nbOnsets = 0;
+    if ( !(labelFileName = malloc(strlen(fileName) + sizeof(TRAINING_LABELEXT))) )
+        return 0;
+    strcpy(labelFileName, fileName);
+    strcat(labelFileName, TRAINING_LABELEXT);
+    labelFile = fopen(labelFileName, "r");
+    free(labelFileName);
+    if (!labelFile)
+        return 0;
+
+    while (fscanf(labelFile, "%lf", &time) == 1)
+    {
+        if (*nbOnsets == maxOnsets)
+        {
+            maxOnsets = maxOnsets ? 2*maxOnsets : 16;
+            if ( !(newOnsets = realloc(*onsets, sizeof(Uint32) * maxOnsets)) )
+            {
+                fclose(labelFile);
+                return 0;
+            }
+            *onsets = newOnsets;
+        }
+        (*onsets)[(*nbOnsets)++] = (Uint32)(time * samplingFreq);
+    }
+
+    fclose(labelFile);
+    return 1;
+}
+
+/* The file is mixed down and fed tick by tick, the frames are looked at as soon as they are made */
+static int AddTrainingFrames(TrainingSet *set, const char fileName[], unsigned int sampleLength, unsigned int tickLength, double cascadeRatio)
+{
+    AudioSource *source;
+    Detector detector;
+    TrainingFrame *frames;
+    Uint32 *onsets = NULL, frame = 0, start;
+    Uint8 *tick = NULL;
+    unsigned int nbOnsets, tickLength_PCM, snapLength_PCM, tailLength_PCM, frameSize, length, j;
+    int n = 0, isSnap, isTail;
+
+    if ( !(source = OpenWAVSource(fileName, 0, 0)) )
+        return 0;
+
+    tickLength_PCM = tickLength * source->samplingFreq / 1000;
+    if (tickLength_PCM < 1)
+        tickLength_PCM = 1;
+    snapLength_PCM = TRAINING_SNAPLENGTH_MS * source->samplingFreq / 1000;
+    tailLength_PCM = TRAINING_TAILLENGTH_MS * source->samplingFreq / 1000;
+    frameSize = GetPCMSampleSize(source->format);
+
+    if (!LoadLabels(fileName, source->samplingFreq, &onsets, &nbOnsets)
+        || !(tick = malloc(tickLength_PCM * frameSize))
+        || !InitDetector(&detector, source->samplingFreq, source->format, sampleLength * source->samplingFreq / 1000, 0,
+                         sampleLength * SOUNDBUFFERLENGTH_FACTOR * source->samplingFreq / 1000, TRAINING_THRESHOLD))
+    {
+        free(onsets);
+        free(tick);
+        CloseAudioSource(source);
+        return 0;
+    }
+    detector.cascadeRatio = cascadeRatio;
+
+    while (n >= 0)
+    {
+        for (length=0 ; length < tickLength_PCM && (n = source->Read(source, tick + length*frameSize, tickLength_PCM - length)) > 0 ; length += n);
+        FeedDetector(&detector, tick, length);
+
+        /* Frames which left the window before being looked at (ticks longer than the window) are lost */
+        if (detector.stft.nbFrames - frame > detector.stft.nbWindowFrames)
+            frame = detector.stft.nbFrames - detector.stft.nbWindowFrames;
+
+        for ( ; frame < detector.stft.nbFrames ; frame++)
+        {
+            if (!IsNoiseModelReady(&detector.stft.noise) || (cascadeRatio > 0 && !IsDetectorCandidate(&detector, frame)))
+                continue;
+
+            start = frame * detector.stft.hopLength;
+            for (j=0, isSnap=0, isTail=0 ; j < nbOnsets ; j++)
+            {
+                if (onsets[j] < start + detector.stft.frameLength && onsets[j] + snapLength_PCM > start)
+                    isSnap = 1;
+                else if (onsets[j] <= start && start < onsets[j] + tailLength_PCM)
+                    isTail = 1;
+            }
+            if (isTail && !isSnap)
+                continue;
+
+            if (set->nbFrames == set->maxFrames)
+            {
+                set->maxFrames = set->maxFrames ? 2*set->maxFrames : 256;
+                if ( !(frames = realloc(set->frames, sizeof(TrainingFrame) * set->maxFrames)) )
+                {
+                    n = -1;
+                    break;
+                }
+                set->frames = frames;
+            }
+
+            GetDetectorFeatures(&detector, frame, set->frames[set->nbFrames].features);
+            set->frames[set->nbFrames++].isSnap = isSnap;
+            set->nbSnaps += isSnap;
+        }
+
+        RunDetector(&detector);
+    }
+
+    FreeDetector(&detector);
+    free(onsets);
+    free(tick);
+    CloseAudioSource(source);
+    return 1;
+}
+
+/* Batch gradient descent on the weighted log loss, with a light L2 penalty on the weights */
+static void TrainClassifier(const TrainingSet *set, double means[FEATURES_SIZE], double scales[FEATURES_SIZE], double weights[FEATURES_SIZE], double *bias)
+{
+    double gradients[FEATURES_SIZE], x[FEATURES_SIZE],
+           snapWeight = 0.5 * set->nbFrames / set->nbSnaps,
+           otherWeight = 0.5 * set->nbFrames / (set->nbFrames - set->nbSnaps),
+           biasGradient, score, error, variance;
+    unsigned int i, k, iteration;
+
+    for (k=0 ; k < FEATURES_SIZE ; k++)
+    {
+        for (i=0, means[k]=0 ; i < set->nbFrames ; i++)
+            means[k] += set->frames[i].features[k];
+        means[k] /= set->nbFrames;
+        for (i=0, variance=0 ; i < set->nbFrames ; i++)
+            variance += (set->frames[i].features[k] - means[k]) * (set->frames[i].features[k] - means[k]);
+        variance /= set->nbFrames;
+        scales[k] = variance > 1e-12 ? 1/sqrt(variance) : 0;
+        weights[k] = 0;
+    }
+    *bias = 0;
+
+    for (iteration=0 ; iteration < TRAINING_NBITERATIONS ; iteration++)
+    {
+        memset(gradients, 0, sizeof(gradients));
+        biasGradient = 0;
+
+        for (i=0 ; i < set->nbFrames ; i++)
+        {
+            for (k=0, score=*bias ; k < FEATURES_SIZE ; k++)
+            {
+                x[k] = (set->frames[i].features[k] - means[k]) * scales[k];
+                score += weights[k] * x[k];
+            }
+            error = 1/(1 + exp(-score)) - set->frames[i].isSnap;
+            error *= set->frames[i].isSnap ? snapWeight : otherWeight;
+
+            for (k=0 ; k < FEATURES_SIZE ; k++)
+                gradients[k] += error * x[k];
+            biasGradient += error;
+        }
+
+        for (k=0 ; k < FEATURES_SIZE ; k++)
+            weights[k] -= TRAINING_RATE * (gradients[k] / set->nbFrames + TRAINING_L2 * weights[k]);
+        *bias -= TRAINING_RATE * biasGradient / set->nbFrames;
+    }
+}
+
+static int WriteModel(const char fileName[], const TrainingSet *set, unsigned int nbFiles, const double means[FEATURES_SIZE],
+                      const double scales[FEATURES_SIZE], const double weights[FEATURES_SIZE], double bias)
+{
+    FILE *modelFile;
+    const double *tabTables[] = {means, scales, weights};
+    const char *tabNames[] = {"tabFeatureMeans", "tabFeatureScales", "tabClassifierWeights"};
+    unsigned int i, k;
+
+    if ( !(modelFile = fopen(fileName, "w")) )
+        return 0;
+
+    fprintf(modelFile, "/* Made by snapd-train over %d file(s), %d snap frame(s) and %d other candidate frame(s).\n"
+                       "   Only included by features.c. */\n"
+                       "#ifndef MODELH\n\n#define MODELH\n\n#define CLASSIFIER_BIAS         %.6g\n\n",
+            nbFiles, set->nbSnaps, set->nbFrames - set->nbSnaps, bias);
+
+    for (i=0 ; i < 3 ; i++)
+    {
+        fprintf(modelFile, "static const float %s[FEATURES_SIZE] =\n{\n   ", tabNames[i]);
+        for (k=0 ; k < FEATURES_SIZE ; k++)
+            fprintf(modelFile, " %#.9gf%s", (float)tabTables[i][k], k+1 < FEATURES_SIZE ? "," : "\n");
+        fprintf(modelFile, "};\n\n");
+    }
+
+    fprintf(modelFile, "#endif\n");
+    fclose(modelFile);
+    return 1;
+}
+
+/* The header must build whatever the values: each one has to be a float literal (a feature which never
+   varies gets a scale and a weight of 0, and "0f" is not one) and give back the float trained. The rows
+   of the tables are the lines which follow a "{". */
+static int CheckModel(const char fileName[], const double means[FEATURES_SIZE], const double scales[FEATURES_SIZE], const double weights[FEATURES_SIZE])
+{
+    FILE *modelFile;
+    const double *tabTables[] = {means, scales, weights};
+    char line[MAX_STRING], *text, *end;
+    unsigned int i = 0, k;
+    int isRow = 0, isOK = 1;
+    double value;
+
+    if ( !(modelFile = fopen(fileName, "r")) )
+        return 0;
+
+    while (isOK && i < 3 && fgets(line, sizeof(line), modelFile))
+    {
+        if (!isRow)
+        {
+            isRow = line[0] == '{';
+            continue;
+        }
+
+        for (k=0, text=line ; k < FEATURES_SIZE && isOK ; k++)
+        {
+            value = strtod(text, &end);
+            isOK = end > text && *end == 'f' && strcspn(text, ".eE") < (size_t)(end - text)
+                   && (float)value == (float)tabTables[i][k] && (k+1 == FEATURES_SIZE || end[1] == ',');
+            text = end + 2;
+        }
+        isRow = 0;
+        i++;
+    }
+
+    fclose(modelFile);
+    return isOK && i == 3;
+}
+
+#endif
+//////////////////////////////////////////////
+
+
+//////////////////////////////////////////////
+/* -------------- Daemon mode --------------*/
+#if (CURRENT_MODE==DAEMON_MODE)
+
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define DAEMON_SAMPLELENGTH     250
+#define DAEMON_THRESHOLD        0.5
+#define DAEMON_SAMPLINGFREQ     22050
+#define DAEMON_MAXCLIENTS       16
+#define DAEMON_ALSAPREFIX       "alsa:"
+
+/* Where the events go: stdout, or every client connected to the Unix socket (listener) */
+typedef struct
+{
+    int listener,
+        tabClients[DAEMON_MAXCLIENTS];
+    unsigned int nbClients;
+} EventOutput;
+
+static volatile sig_atomic_t isStopping = 0;
+
+static void StopDaemon(int signalNumber);
+static AudioSource* OpenDaemonSource(const char input[], unsigned int rawFreq, FILE **file);
+static void CloseDaemonInput(FILE *file);
+static int OpenEventOutput(EventOutput *output, const char socketPath[]);
+static void CloseEventOutput(EventOutput *output, const char socketPath[]);
+static void AcceptEventClients(EventOutput *output);
+static int WriteEvent(EventOutput *output, const char line[]);
+
+
+/* snapd-daemon [-t threshold] [-l window_ms] [-p latency_ms] [-r rate] [-n noise_file] [-u socket] [input]
+   Long-running headless analysis: reads the input tick by tick and writes a line per snap, until the
+   input ends or the daemon gets SIGINT or SIGTERM. It stays in the foreground, for a service manager.
+   The input is a WAV stream (a file, a FIFO, or stdin if it is - or left out), a raw stream of signed
+   8-bit samples at rate Hz if -r is given, or a capture device (alsa:device, if built with HAVE_ALSA).
+   Streams are only read as they come: a FIFO fed from a WAV file is analysed as the microphone would be.
+   There is no other thread, and the daemon sleeps in the read between two ticks.
+   Each line is "onset,time,band1,band2,band3,band4", times in seconds since the start of the input, as
+   in the batch results. They go to stdout, or with -u to every client of a Unix socket made at that path.
+   -n loads the noise floor from that file at start and saves it there at exit.
+   Exit codes: 1 for the arguments, 2 if the input or the output cannot be opened. */
+int main(int argc, char *argv[])
+{
+    AudioSource *source = NULL;
+    FILE *inputFile = NULL;
+    Detector detector;
+    EventOutput output;
+    struct sigaction action;
+    const char *input = "-",
+               *socketPath = NULL,
+               *noiseFileName = NULL;
+    char line[MAX_STRING];
+    unsigned int sampleLength = DAEMON_SAMPLELENGTH,
+                 latencyBudget = 0, rawFreq = 0,
+                 hopLength, tickLength, tickLength_PCM, samplingFreq, i;
+    double threshold = DAEMON_THRESHOLD;
+    Uint8 *tick = NULL;
+    int n, isSnapshot;
+
+    for (i=1 ; i < argc && argv[i][0] == '-' && argv[i][1] ; i++)
+    {
+        if (i+1 >= argc)    /* the flag is left at argv[i], for the usage below */
+            break;
+        else if (!strcmp(argv[i], "-t"))
+            threshold = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-l"))
+            sampleLength = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-p"))
+            latencyBudget = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-r"))
+            rawFreq = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n"))
+            noiseFileName = argv[++i];
+        else if (!strcmp(argv[i], "-u"))
+            socketPath = argv[++i];
+        else break;
+    }
+
+    if (i+1 < argc || (i < argc && argv[i][0] == '-' && argv[i][1]) || !sampleLength)
+    {
+        fprintf(stderr, "Usage: %s [-t threshold] [-l window_ms] [-p latency_ms] [-r rate] [-n noise_file] [-u socket] [input]\n", argv[0]);
+        return 1;
+    }
+    if (i < argc)
+        input = argv[i];
+
+    /* No SA_RESTART: the read the daemon waits in is interrupted */
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = StopDaemon;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* The socket listens first: opening a FIFO blocks until its writer comes, and clients may already connect */
+    if (!OpenEventOutput(&output, socketPath))
+    {
+        fprintf(stderr, "Unable to create the socket '%s'.\n", socketPath);
+        return 2;
+    }
+    if ( !(source = OpenDaemonSource(input, rawFreq, &inputFile)) )
+    {
+        fprintf(stderr, "Unable to open the input '%s'.\n", input);
+        CloseEventOutput(&output, socketPath);
+        return 2;
+    }
+
+    SDL_Init(0);
+    InitDFT(DFT_WISDOM_FILE);
+
+    samplingFreq = source->samplingFreq;
+    GetDetectorProfile(latencyBudget, &hopLength, &tickLength);
+    tickLength_PCM = tickLength * samplingFreq / 1000;
+    if (tickLength_PCM < 1)
+        tickLength_PCM = 1;
+
+    if ( !(tick = malloc(tickLength_PCM * GetPCMSampleSize(source->format)))
+        || !InitDetector(&detector, samplingFreq, source->format, sampleLength * samplingFreq / 1000, hopLength * samplingFreq / 1000,
+                         sampleLength * SOUNDBUFFERLENGTH_FACTOR * samplingFreq / 1000, threshold) )
+    {
+        free(tick);
+        CloseEventOutput(&output, socketPath);
+        CloseAudioSource(source);
+        CloseDaemonInput(inputFile);
+        QuitDFT(DFT_WISDOM_FILE);
+        SDL_Quit();
+        return 2;
+    }
+    if (noiseFileName)
+        LoadSTFTNoise(&detector.stft, noiseFileName);
+    fprintf(stderr, "Listening to '%s' at %d Hz, window of %d ms, tick of %d ms.\n", source->description, samplingFreq, sampleLength, tickLength);
+
+    /* Read returns 0 after an overrun of the device, which is then capturing again */
+    while (!isStopping && (n = source->Read(source, tick, tickLength_PCM)) >= 0)
+    {
+        if (n == 0)
+            continue;
+
+        TickDetector(&detector, tick, n, NULL, 0, &isSnapshot);
+        AcceptEventClients(&output);
+        if (isSnapshot)
+        {
+            sprintf(line, "%.3f,%.3f,%f,%f,%f,%f\n", (double)detector.lastOnset / samplingFreq, (double)detector.nbSamples / samplingFreq,
+                    detector.bandPowers[0], detector.bandPowers[1], detector.bandPowers[2], detector.bandPowers[3]);
+            if (!WriteEvent(&output, line))
+                break;
+        }
+    }
+
+    fprintf(stderr, "%d snap(s) detected in %.1f s.\n", detector.nbDetections, (double)detector.nbSamples / samplingFreq);
+    if (noiseFileName)
+        SaveSTFTNoise(&detector.stft, noiseFileName);
+
+    FreeDetector(&detector);
+    free(tick);
+    CloseEventOutput(&output, socketPath);
+    CloseAudioSource(source);
+    CloseDaemonInput(inputFile);
+    QuitDFT(DFT_WISDOM_FILE);
+    SDL_Quit();
+
+    return 0;
+}
+
+static void StopDaemon(int signalNumber)
+{
+    isStopping = 1;
+}
+
+/* Streams are not paced: they come as fast as whoever writes them. file is the stream the source reads,
+   if it is not a device. */
+static AudioSource* OpenDaemonSource(const char input[], unsigned int rawFreq, FILE **file)
+{
+    AudioSource *source;
+
+    if (!strncmp(input, DAEMON_ALSAPREFIX, strlen(DAEMON_ALSAPREFIX)))
+    {
+#ifdef HAVE_ALSA
+        return OpenALSASource(input + strlen(DAEMON_ALSAPREFIX), rawFreq ? rawFreq : DAEMON_SAMPLINGFREQ, PCM_FORMAT_PCM16);
+#else
+        return NULL;
+#endif
+    }
+
+    if (!strcmp(input, "-"))
+        *file = stdin;
+    else if ( !(*file = fopen(input, "rb")) )
+        return NULL;
+
+    if (rawFreq > 0)
+        source = OpenRawSource(*file, rawFreq, 0);
+    else source = OpenWAVStream(*file, input, 0, 0);
+
+    if (!source)
+    {
+        CloseDaemonInput(*file);
+        *file = NULL;
+    }
+    return source;
+}
+
+static void CloseDaemonInput(FILE *file)
+{
+    if (file && file != stdin)
+        fclose(file);
+}
+
+/* The listener does not block: clients are only taken between two ticks */
+static int OpenEventOutput(EventOutput *output, const char socketPath[])
+{
+    struct sockaddr_un address;
+
+    memset(output, 0, sizeof(EventOutput));
+    output->listener = -1;
+    if (!socketPath)
+        return 1;
+
+    if (strlen(socketPath) >= sizeof(address.sun_path)
+        || (output->listener = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        return 0;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+    unlink(socketPath);
+
+    if (bind(output->listener, (struct sockaddr*)&address, sizeof(address)) < 0
+        || listen(output->listener, DAEMON_MAXCLIENTS) < 0
+        || fcntl(output->listener, F_SETFL, O_NONBLOCK) < 0)
+    {
+        close(output->listener);
+        output->listener = -1;
+        return 0;
+    }
+
+    return 1;
+}
+
+static void CloseEventOutput(EventOutput *output, const char socketPath[])
+{
+    unsigned int i;
+
+    for (i=0 ; i < output->nbClients ; i++)
+        close(output->tabClients[i]);
+    if (output->listener >= 0)
+    {
+        close(output->listener);
+        unlink(socketPath);
+    }
+    memset(output, 0, sizeof(EventOutput));
+}
+
+static void AcceptEventClients(EventOutput *output)
+{
+    int client;
+
+    while (output->listener >= 0 && (client = accept(output->listener, NULL, NULL)) >= 0)
+    {
+        if (output->nbClients < DAEMON_MAXCLIENTS && fcntl(client, F_SETFL, O_NONBLOCK) >= 0)
+            output->tabClients[output->nbClients++] = client;
+        else close(client);
+    }
+}
+
+/* A client which cannot take the line at once is dropped, rather than holding up the analysis.
+   Returns 0 if stdout is closed. */
+static int WriteEvent(EventOutput *output, const char line[])
+{
+    unsigned int i = 0;
+    size_t length = strlen(line);
+
+    if (output->listener < 0)
+        return fputs(line, stdout) >= 0 && fflush(stdout) == 0;
+
+    while (i < output->nbClients)
+    {
+        if (send(output->tabClients[i], line, length, MSG_NOSIGNAL) != (ssize_t)length)
+        {
+            close(output->tabClients[i]);
+            output->tabClients[i] = output->tabClients[--output->nbClients];
+        }
+        else i++;
+    }
+
+    return 1;
+}
+
+#endif
+//////////////////////////////////////////////
+
+
+#if (CURRENT_MODE==EXPERIMENTAL_MODE || CURRENT_MODE==BENCHMARK_MODE)
+static int IsSnapshotEx(DFTReal *modules, unsigned int sampleLength_PCM, unsigned int samplingFreq,
+                        double *sum1_out, double *sum2_out, double *sum3_out, double *sum4_out, double *sum_out)
+{
+    double bandPowers[4],
+           sum1, sum2, sum3, sum4, sum;
+    static Uint32 lastDetectionTime = -TIMESPACEMIN;
+
+    GetBandPowers(modules, sampleLength_PCM, samplingFreq, bandPowers);
+    sum1 = bandPowers[0];
+    sum2 = bandPowers[1];
+    sum3 = bandPowers[2];
+    sum4 = bandPowers[3];
+    sum = sum1 + sum2 + sum3 + sum4;
+
+    if (sum_out)
+        *sum_out = sum;
+    if (sum1_out)
+        *sum1_out = sum1;
+    if (sum2_out)
+        *sum2_out = sum2;
+    if (sum3_out)
+        *sum3_out = sum3;
+    if (sum4_out)
+        *sum4_out = sum4;
+
+    if ((int)(SDL_GetTicks() - lastDetectionTime) < TIMESPACEMIN)
+        return 0;
+    else if (sum3 > 0.5*sum4 && sum3 > 2*sum2)
+    {
+        lastDetectionTime = SDL_GetTicks();
+        //WriteOutputFile(modules, "out.txt", sampleLength_PCM, samplingFreq);
+        return 1;
+    }
+    else return 0;
+}
+#endif
+
+#if (CURRENT_MODE==EXPERIMENTAL_MODE)
+static int WriteOutputFile(DFTReal *modules, const char fileName[], unsigned int sampleLength_PCM, unsigned int samplingRate)
+{
+    FILE *outFile = NULL;
+    int i;
+
+    printf("Writing results...\n");
+    if ( !(outFile = fopen(fileName, "w")) )
+    {
+        printf("Unable to create the output file. Exiting.\n");
+        return 0;
+    }
+    fprintf(outFile, "Frequency - Value\n");
+    for (i=0 ; i < sampleLength_PCM/2+1 ; i++)
+        fprintf(outFile, "%d - %.6f\n", i * samplingRate/sampleLength_PCM, modules[i]);
+    fclose(outFile);
+
+    return 1;
+}
+#endif
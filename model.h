@@ -0,0 +1,24 @@
+/* Made by snapd-train over 4 file(s), 33 snap frame(s) and 39 other candidate frame(s).
+   Only included by features.c. */
+#ifndef MODELH
+
+#define MODELH
+
+#define CLASSIFIER_BIAS         -0.303233
+
+static const float tabFeatureMeans[FEATURES_SIZE] =
+{
+    -0.707878f, 0.750382f, 1.32571f, 1.13791f, 0.811234f, 0.501787f, -0.374575f, -0.211773f, -0.070468f, -0.158575f
+};
+
+static const float tabFeatureScales[FEATURES_SIZE] =
+{
+    0.839234f, 1.97118f, 1.80622f, 1.91533f, 2.41218f, 7.91112f, 3.25229f, 6.269f, 7.13169f, 10.4263f
+};
+
+static const float tabClassifierWeights[FEATURES_SIZE] =
+{
+    -0.661403f, -0.611322f, 1.7055f, 0.169602f, -1.45602f, -1.88422f, -1.01736f, -2.20611f, 3.94731f, -1.60831f
+};
+
+#endif
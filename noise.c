@@ -0,0 +1,96 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "noise.h"
+
+
+int InitNoiseModel(NoiseModel *noise, unsigned int nbBins, unsigned int timeConstant, unsigned int readyFrames, double scale)
+{
+    memset(noise, 0, sizeof(NoiseModel));
+
+    noise->nbBins = nbBins;
+    noise->timeConstant = timeConstant > 0 ? timeConstant : 1;
+    noise->readyFrames = readyFrames;
+    noise->scale = scale;
+    noise->powers = calloc(nbBins, sizeof(DFTReal));
+    noise->modules = calloc(nbBins, sizeof(DFTReal));
+
+    if (!noise->powers || !noise->modules)
+    {
+        FreeNoiseModel(noise);
+        return 0;
+    }
+
+    return 1;
+}
+
+void FreeNoiseModel(NoiseModel *noise)
+{
+    free(noise->powers);
+    free(noise->modules);
+    memset(noise, 0, sizeof(NoiseModel));
+}
+
+/* Only the first nbBins bins are updated, the others keep their last estimate */
+void UpdateNoiseModel(NoiseModel *noise, const DFTReal *framePowers, unsigned int nbBins)
+{
+    unsigned int i;
+    DFTReal alpha;
+
+    if (nbBins > noise->nbBins)
+        nbBins = noise->nbBins;
+
+    if (noise->nbFrames < noise->timeConstant)
+        noise->nbFrames++;
+    alpha = 1.0 / noise->nbFrames;
+
+    for (i=0 ; i < nbBins ; i++)
+        noise->powers[i] += alpha * (framePowers[i] - noise->powers[i]);
+}
+
+/* Takes a floor estimated before (by a previous run) as if readyFrames frames had been seen: the model is
+   ready at once, and the first frames still weigh enough to correct a floor which has changed since */
+void RestoreNoiseModel(NoiseModel *noise, const DFTReal *powers)
+{
+    memcpy(noise->powers, powers, sizeof(DFTReal) * noise->nbBins);
+    noise->nbFrames = noise->readyFrames > 0 ? noise->readyFrames : 1;
+    if (noise->nbFrames > noise->timeConstant)
+        noise->nbFrames = noise->timeConstant;
+}
+
+int IsNoiseModelReady(const NoiseModel *noise)
+{
+    return noise->nbFrames > 0 && noise->nbFrames >= noise->readyFrames;
+}
+
+/* Every frame now weighs 1/timeConstant: the estimate no longer moves much with each of them */
+int IsNoiseModelSettled(const NoiseModel *noise)
+{
+    return noise->nbFrames >= noise->timeConstant;
+}
+
+DFTReal* GetNoiseModules(NoiseModel *noise)
+{
+    unsigned int i;
+
+    for (i=0 ; i < noise->nbBins ; i++)
+        noise->modules[i] = DFTSqrt(noise->scale * noise->powers[i]);
+
+    return noise->modules;
+}
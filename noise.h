@@ -0,0 +1,46 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef NOISEH
+
+#define NOISEH
+
+#include "dft.h"
+
+/* Per-bin noise floor, as an exponential average of frame powers.
+   The average is cumulative until timeConstant frames have been seen, so that the estimate is usable
+   early. The modules are scaled to what a transform over scale frames would give, which is what the
+   detection thresholds were tuned against. */
+typedef struct
+{
+    unsigned int nbBins,
+                 nbFrames,
+                 timeConstant,
+                 readyFrames;
+    double scale;
+    DFTReal *powers,
+            *modules;
+} NoiseModel;
+
+int InitNoiseModel(NoiseModel *noise, unsigned int nbBins, unsigned int timeConstant, unsigned int readyFrames, double scale);
+void FreeNoiseModel(NoiseModel *noise);
+void UpdateNoiseModel(NoiseModel *noise, const DFTReal *framePowers, unsigned int nbBins);
+void RestoreNoiseModel(NoiseModel *noise, const DFTReal *powers);
+int IsNoiseModelReady(const NoiseModel *noise);
+int IsNoiseModelSettled(const NoiseModel *noise);
+DFTReal* GetNoiseModules(NoiseModel *noise);
+
+#endif
@@ -0,0 +1,63 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+#include <string.h>
+#include "pcm.h"
+
+typedef struct
+{
+    char name[10];
+    unsigned int sampleSize;
+    double scale;
+} PCMFormat;
+
+static PCMFormat tabFormats[PCM_NBFORMATS] =
+{
+    { "pcm8", 1, PCM_SCALE_PCM8 },
+    { "pcm16", 2, PCM_SCALE_PCM16 },
+    { "float", 4, PCM_SCALE_FLOAT }
+};
+
+
+unsigned int GetPCMSampleSize(int format)
+{
+    return tabFormats[format].sampleSize;
+}
+
+double GetPCMScale(int format)
+{
+    return tabFormats[format].scale;
+}
+
+const char* GetPCMFormatName(int format)
+{
+    return tabFormats[format].name;
+}
+
+/* Returns -1 if the name is unknown */
+int GetPCMFormat(const char name[])
+{
+    int i;
+
+    for (i=0 ; i < PCM_NBFORMATS ; i++)
+    {
+        if (!strcmp(name, tabFormats[i].name))
+            return i;
+    }
+
+    return -1;
+}
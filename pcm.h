@@ -0,0 +1,41 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+#ifndef PCMH
+
+#define PCMH
+
+#include <SDL.h>
+
+/* Sample formats of the recorded sound. Whatever the format, the analysis sees samples in [-1,1]:
+   PCM16 is scaled as if its low byte were dropped (32512 = 127*256), so the thresholds tuned on
+   PCM8 keep their meaning, and float samples are taken as they are. */
+#define PCM_FORMAT_PCM8         0
+#define PCM_FORMAT_PCM16        1
+#define PCM_FORMAT_FLOAT        2
+#define PCM_NBFORMATS           3
+
+#define PCM_SCALE_PCM8          (1/127.0)
+#define PCM_SCALE_PCM16         (1/32512.0)
+#define PCM_SCALE_FLOAT         1.0
+
+unsigned int GetPCMSampleSize(int format);
+double GetPCMScale(int format);
+const char* GetPCMFormatName(int format);
+int GetPCMFormat(const char name[]);
+
+#endif
@@ -0,0 +1,158 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "pcm.h"
+#include "record.h"
+
+#define RECORD_MAGIC            "SNAPLOG1"
+#define RECORD_HEADERSIZE       40
+
+static void WriteLE(Uint8 *data, Uint32 value);
+static Uint32 ReadLE(const Uint8 *data);
+
+
+int CreateRecord(Record *record, const char fileName[], const RecordHeader *header)
+{
+    Uint8 buffer[RECORD_HEADERSIZE];
+
+    memset(record, 0, sizeof(Record));
+    record->frameSize = GetPCMSampleSize(header->format) * header->nbChannels;
+
+    memcpy(buffer, RECORD_MAGIC, 8);
+    WriteLE(buffer+8, header->samplingFreq);
+    WriteLE(buffer+12, header->format);
+    WriteLE(buffer+16, header->nbChannels);
+    WriteLE(buffer+20, header->windowLength_PCM);
+    WriteLE(buffer+24, header->hopLength_PCM);
+    WriteLE(buffer+28, header->bufferLength_PCM);
+    WriteLE(buffer+32, (Uint32)(header->threshold * 1e6 + 0.5));
+    WriteLE(buffer+36, SDL_BYTEORDER);
+
+    if ( !(record->file = fopen(fileName, "wb")) )
+        return 0;
+    if (fwrite(buffer, 1, RECORD_HEADERSIZE, record->file) != RECORD_HEADERSIZE)
+    {
+        CloseRecord(record);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* The samples of a tick may come in two parts, as a ring gives them */
+int WriteRecordTick(Record *record, const void *pcmData1, unsigned int length1, const void *pcmData2, unsigned int length2, int flags)
+{
+    Uint8 buffer[5];
+
+    WriteLE(buffer, length1 + length2);
+    buffer[4] = flags;
+
+    record->nbTicks++;
+    return fwrite(buffer, 1, 5, record->file) == 5
+           && fwrite(pcmData1, record->frameSize, length1, record->file) == length1
+           && (!length2 || fwrite(pcmData2, record->frameSize, length2, record->file) == length2);
+}
+
+int OpenRecord(Record *record, const char fileName[], RecordHeader *header)
+{
+    Uint8 buffer[RECORD_HEADERSIZE];
+
+    memset(record, 0, sizeof(Record));
+
+    if ( !(record->file = fopen(fileName, "rb")) )
+        return 0;
+
+    if (fread(buffer, 1, RECORD_HEADERSIZE, record->file) != RECORD_HEADERSIZE
+        || memcmp(buffer, RECORD_MAGIC, 8) || ReadLE(buffer+36) != SDL_BYTEORDER)
+    {
+        CloseRecord(record);
+        return 0;
+    }
+
+    header->samplingFreq = ReadLE(buffer+8);
+    header->format = ReadLE(buffer+12);
+    header->nbChannels = ReadLE(buffer+16);
+    header->windowLength_PCM = ReadLE(buffer+20);
+    header->hopLength_PCM = ReadLE(buffer+24);
+    header->bufferLength_PCM = ReadLE(buffer+28);
+    header->threshold = ReadLE(buffer+32) / 1e6;
+
+    if (!header->samplingFreq || header->format >= PCM_NBFORMATS || !header->nbChannels || header->nbChannels > RECORD_MAXCHANNELS)
+    {
+        CloseRecord(record);
+        return 0;
+    }
+    record->frameSize = GetPCMSampleSize(header->format) * header->nbChannels;
+
+    return 1;
+}
+
+/* pcmData stays valid until the next call. Returns 0 at the end of the log, -1 if it is cut short. */
+int ReadRecordTick(Record *record, const void **pcmData, unsigned int *length, int *flags)
+{
+    Uint8 buffer[5], *data;
+    size_t n;
+
+    if ((n = fread(buffer, 1, 5, record->file)) != 5)
+        return n ? -1 : 0;
+
+    *length = ReadLE(buffer);
+    *flags = buffer[4];
+
+    if (*length > record->maxLength)
+    {
+        if ( !(data = realloc(record->data, *length * record->frameSize)) )
+            return -1;
+        record->data = data;
+        record->maxLength = *length;
+    }
+
+    if (fread(record->data, record->frameSize, *length, record->file) != *length)
+        return -1;
+
+    *pcmData = record->data;
+    record->nbTicks++;
+    return 1;
+}
+
+void CloseRecord(Record *record)
+{
+    if (record->file)
+        fclose(record->file);
+    free(record->data);
+    memset(record, 0, sizeof(Record));
+}
+
+static void WriteLE(Uint8 *data, Uint32 value)
+{
+    int i;
+
+    for (i=0 ; i < 4 ; i++, value >>= 8)
+        data[i] = value & 0xFF;
+}
+
+static Uint32 ReadLE(const Uint8 *data)
+{
+    Uint32 value = 0;
+    int i;
+
+    for (i=3 ; i >= 0 ; i--)
+        value = (value << 8) | data[i];
+
+    return value;
+}
@@ -0,0 +1,63 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef RECORDH
+
+#define RECORDH
+
+#include <stdio.h>
+#include <SDL.h>
+
+#define RECORD_SNAP             1
+#define RECORD_FULLSPECTRUM     2
+#define RECORD_MAXCHANNELS      32
+
+/* The noise profile the live detector started with is kept next to the log, under its name followed by
+   RECORD_NOISEEXT, so that the replay starts from the same one */
+#define RECORD_NOISEEXT         ".noise"
+
+/* What the detector was set up with, so that a replay makes the same one */
+typedef struct
+{
+    unsigned int samplingFreq,
+                 format,
+                 nbChannels,
+                 windowLength_PCM,
+                 hopLength_PCM,
+                 bufferLength_PCM;
+    double threshold;
+} RecordHeader;
+
+/* Log of the exact stream the live detector consumed, tick by tick: a header, then for every tick the
+   number of samples fed, its RECORD_xxx flags (what the detector decided and whether the full spectrum
+   was computed) and the samples themselves, in the byte order of the machine which recorded them.
+   The same structure writes (CreateRecord) or reads (OpenRecord) a log. */
+typedef struct
+{
+    FILE *file;
+    unsigned int frameSize,
+                 maxLength;
+    Uint8 *data;
+    Uint32 nbTicks;
+} Record;
+
+int CreateRecord(Record *record, const char fileName[], const RecordHeader *header);
+int WriteRecordTick(Record *record, const void *pcmData1, unsigned int length1, const void *pcmData2, unsigned int length2, int flags);
+int OpenRecord(Record *record, const char fileName[], RecordHeader *header);
+int ReadRecordTick(Record *record, const void **pcmData, unsigned int *length, int *flags);
+void CloseRecord(Record *record);
+
+#endif
@@ -51,6 +51,7 @@ GNU General Public License for more details.
 #define IDTB_THRESHOLD 29
 #define IDTB_SAMPLELENGTH 30
 #define IDET_THRESHOLD 31
+#define IDCK_LOWLATENCY 32
 
 #endif
 
@@ -0,0 +1,124 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "atomics.h"
+#include "ring.h"
+
+
+int InitPCMRing(PCMRing *ring, unsigned int minSize, unsigned int sampleSize)
+{
+    memset(ring, 0, sizeof(PCMRing));
+
+    ring->size = 1;
+    while (ring->size < minSize)
+        ring->size *= 2;
+    ring->mask = ring->size - 1;
+    ring->sampleSize = sampleSize;
+
+    if ( !(ring->data = malloc(ring->size * sampleSize)) )
+        return 0;
+
+    return 1;
+}
+
+void FreePCMRing(PCMRing *ring)
+{
+    free(ring->data);
+    memset(ring, 0, sizeof(PCMRing));
+}
+
+unsigned int GetPCMRingSpace(PCMRing *ring, void **data)
+{
+    Uint32 writePos = ring->writePos,
+           space = ring->size - (writePos - AtomicGet(&ring->readPos)),
+           offset = writePos & ring->mask;
+
+    if (space > ring->size - offset)
+        space = ring->size - offset;
+    if (data)
+        *data = ring->data + offset*ring->sampleSize;
+
+    return space;
+}
+
+void CommitPCMRing(PCMRing *ring, unsigned int length)
+{
+    AtomicSet(&ring->writePos, ring->writePos + length);
+}
+
+unsigned int WritePCMRing(PCMRing *ring, const void *data, unsigned int length)
+{
+    void *dest;
+    unsigned int n, written = 0;
+
+    while (written < length && (n = GetPCMRingSpace(ring, &dest)) > 0)
+    {
+        if (n > length - written)
+            n = length - written;
+        memcpy(dest, (const Uint8*)data + written*ring->sampleSize, n*ring->sampleSize);
+        CommitPCMRing(ring, n);
+        written += n;
+    }
+
+    return written;
+}
+
+unsigned int PeekPCMRing(PCMRing *ring, const void **data1, unsigned int *len1, const void **data2, unsigned int *len2)
+{
+    Uint32 readPos = ring->readPos,
+           available = AtomicGet(&ring->writePos) - readPos,
+           offset = readPos & ring->mask;
+
+    *data1 = ring->data + offset*ring->sampleSize;
+    *data2 = ring->data;
+    if (available > ring->size - offset)
+    {
+        *len1 = ring->size - offset;
+        *len2 = available - *len1;
+    }
+    else
+    {
+        *len1 = available;
+        *len2 = 0;
+    }
+
+    return available;
+}
+
+void SkipPCMRing(PCMRing *ring, unsigned int length)
+{
+    AtomicSet(&ring->readPos, ring->readPos + length);
+}
+
+unsigned int ReadPCMRing(PCMRing *ring, void *data, unsigned int length)
+{
+    const void *data1, *data2;
+    unsigned int len1, len2;
+
+    PeekPCMRing(ring, &data1, &len1, &data2, &len2);
+    if (len1 > length)
+        len1 = length;
+    if (len2 > length - len1)
+        len2 = length - len1;
+
+    memcpy(data, data1, len1*ring->sampleSize);
+    memcpy((Uint8*)data + len1*ring->sampleSize, data2, len2*ring->sampleSize);
+    SkipPCMRing(ring, len1 + len2);
+
+    return len1 + len2;
+}
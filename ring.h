@@ -0,0 +1,48 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef RINGH
+
+#define RINGH
+
+#include <SDL.h>
+
+/* Single-producer / single-consumer lock-free ring of PCM samples of sampleSize bytes each.
+   readPos and writePos are free-running counters; the size is a power of two so that they can wrap
+   around 2^32 without special care. Only the producer writes writePos, only the consumer writes readPos.
+   Sizes, positions and lengths are all counted in samples. */
+typedef struct
+{
+    Uint32 size,
+           mask;
+    volatile Uint32 readPos,
+                    writePos;
+    unsigned int sampleSize;
+    Uint8 *data;
+} PCMRing;
+
+int InitPCMRing(PCMRing *ring, unsigned int minSize, unsigned int sampleSize);
+void FreePCMRing(PCMRing *ring);
+
+unsigned int GetPCMRingSpace(PCMRing *ring, void **data);
+void CommitPCMRing(PCMRing *ring, unsigned int length);
+unsigned int WritePCMRing(PCMRing *ring, const void *data, unsigned int length);
+
+unsigned int PeekPCMRing(PCMRing *ring, const void **data1, unsigned int *len1, const void **data2, unsigned int *len2);
+void SkipPCMRing(PCMRing *ring, unsigned int length);
+unsigned int ReadPCMRing(PCMRing *ring, void *data, unsigned int length);
+
+#endif
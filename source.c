@@ -0,0 +1,618 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "atomics.h"
+#include "source.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Signed samples in the byte order of the machine, which do not have to be mixed down, are already in
+   the source format */
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+#define IsDirectStream(data)    ((data)->nbOutChannels == (data)->nbChannels && !(data)->isUnsigned)
+#else
+#define IsDirectStream(data)    ((data)->nbOutChannels == (data)->nbChannels && (data)->sampleSize == 1 && !(data)->isUnsigned)
+#endif
+
+typedef struct
+{
+    FILE *file;
+    int ownFile;
+    unsigned int nbChannels,
+                 nbOutChannels,
+                 sampleSize,
+                 isUnsigned,
+                 isFloat,
+                 remaining;
+    Uint8 buffer[CAPTURE_CHUNKLENGTH * 8];
+} FileData;
+
+typedef struct
+{
+    unsigned int snapPeriod,
+                 length,
+                 position;
+    double noiseLevel;
+    Uint32 seed;
+} SyntheticData;
+
+static AudioSource* CreateAudioSource(const char description[], unsigned int samplingFreq, int format, void *data);
+static int CaptureThread(void *param);
+static int ReadStream(AudioSource *source, void *buffer, unsigned int maxLength);
+static void CloseStream(AudioSource *source);
+static void FreeFileData(FileData *data);
+static double ReadFileSample(const FileData *data, const Uint8 *frame, unsigned int channel);
+static int ReadSynthetic(AudioSource *source, void *buffer, unsigned int maxLength);
+static void CloseSynthetic(AudioSource *source);
+static void StoreSample(void *buffer, unsigned int i, int format, double value);
+static unsigned int ReadLE(const Uint8 *data, int nbBytes);
+static void SkipStream(FILE *file, unsigned int length);
+
+
+#ifndef NO_FMOD
+typedef struct
+{
+    FMOD_SYSTEM *system;
+    FMOD_SOUND *sound;
+    int driverId;
+    unsigned int length,
+                 lastRecPos;
+} FMODData;
+
+static FMOD_SOUND_FORMAT tabFMODFormats[PCM_NBFORMATS] =
+{
+    FMOD_SOUND_FORMAT_PCM8,
+    FMOD_SOUND_FORMAT_PCM16,
+    FMOD_SOUND_FORMAT_PCMFLOAT
+};
+
+static int ReadFMOD(AudioSource *source, void *buffer, unsigned int maxLength);
+static void CloseFMOD(AudioSource *source);
+
+/* The length is in samples, FMOD wants it in bytes */
+FMOD_SOUND* CreateSoundBuffer(FMOD_SYSTEM *system, unsigned int length, unsigned int samplingFreq, int format)
+{
+    FMOD_SOUND *soundBuffer = NULL;
+    FMOD_CREATESOUNDEXINFO soundInfo = {0};
+
+    soundInfo.cbsize = sizeof(FMOD_CREATESOUNDEXINFO);
+    soundInfo.length = length * GetPCMSampleSize(format);
+    soundInfo.numchannels = 1;
+    soundInfo.defaultfrequency = samplingFreq;
+    soundInfo.format = tabFMODFormats[format];
+    FMOD_System_CreateSound(system, NULL, FMOD_OPENUSER, &soundInfo, &soundBuffer);
+
+    return soundBuffer;
+}
+
+AudioSource* OpenFMODSource(FMOD_SYSTEM *system, int driverId, unsigned int samplingFreq, int format, unsigned int bufferLength_PCM)
+{
+    FMODData *data = NULL;
+    AudioSource *source = NULL;
+
+    if ( !(data = calloc(1, sizeof(FMODData))) )
+        return NULL;
+
+    data->system = system;
+    data->driverId = driverId;
+    data->length = bufferLength_PCM;
+    if ( !(data->sound = CreateSoundBuffer(system, bufferLength_PCM, samplingFreq, format))
+        || !(source = CreateAudioSource("FMOD recording driver", samplingFreq, format, data)) )
+    {
+        if (data->sound)
+            FMOD_Sound_Release(data->sound);
+        free(data);
+        return NULL;
+    }
+
+    source->isLive = 1;
+    source->Read = ReadFMOD;
+    source->Close = CloseFMOD;
+    FMOD_System_RecordStart(system, driverId, data->sound, 1);
+
+    return source;
+}
+
+/* The record position is in samples, the lock in bytes */
+static int ReadFMOD(AudioSource *source, void *buffer, unsigned int maxLength)
+{
+    FMODData *data = source->data;
+    void *pcmData1, *pcmData2;
+    unsigned int len1, len2, recPos, length,
+                 sampleSize = GetPCMSampleSize(source->format);
+
+    FMOD_System_GetRecordPosition(data->system, data->driverId, &recPos);
+    if (recPos == data->lastRecPos || recPos >= data->length)
+        return 0;
+
+    length = (recPos + data->length - data->lastRecPos) % data->length;
+    if (length > maxLength)
+        length = maxLength;
+
+    FMOD_Sound_Lock(data->sound, data->lastRecPos*sampleSize, length*sampleSize, &pcmData1, &pcmData2, &len1, &len2);
+    memcpy(buffer, pcmData1, len1);
+    if (pcmData2)
+        memcpy((Uint8*)buffer + len1, pcmData2, len2);
+    FMOD_Sound_Unlock(data->sound, pcmData1, pcmData2, len1, len2);
+
+    data->lastRecPos = (data->lastRecPos + length) % data->length;
+    return length;
+}
+
+static void CloseFMOD(AudioSource *source)
+{
+    FMODData *data = source->data;
+
+    FMOD_System_RecordStop(data->system, data->driverId);
+    FMOD_Sound_Release(data->sound);
+    free(data);
+}
+#endif
+
+#ifdef HAVE_ALSA
+static snd_pcm_format_t tabALSAFormats[PCM_NBFORMATS] =
+{
+    SND_PCM_FORMAT_S8,
+    SND_PCM_FORMAT_S16,
+    SND_PCM_FORMAT_FLOAT
+};
+
+static int ReadALSA(AudioSource *source, void *buffer, unsigned int maxLength);
+static void CloseALSA(AudioSource *source);
+
+/* Mono capture, resampled by ALSA if the device cannot take samplingFreq itself */
+AudioSource* OpenALSASource(const char device[], unsigned int samplingFreq, int format)
+{
+    snd_pcm_t *pcm = NULL;
+    AudioSource *source = NULL;
+
+    if (snd_pcm_open(&pcm, device, SND_PCM_STREAM_CAPTURE, 0) < 0)
+        return NULL;
+    if (snd_pcm_set_params(pcm, tabALSAFormats[format], SND_PCM_ACCESS_RW_INTERLEAVED, 1, samplingFreq, 1, ALSA_LATENCY_US) < 0
+        || !(source = CreateAudioSource(device, samplingFreq, format, pcm)))
+    {
+        snd_pcm_close(pcm);
+        return NULL;
+    }
+
+    source->isLive = 1;
+    source->Read = ReadALSA;
+    source->Close = CloseALSA;
+    return source;
+}
+
+/* An overrun loses the samples ALSA could not keep, the capture then goes on */
+static int ReadALSA(AudioSource *source, void *buffer, unsigned int maxLength)
+{
+    snd_pcm_sframes_t n = snd_pcm_readi(source->data, buffer, maxLength);
+
+    if (n < 0)
+        return snd_pcm_recover(source->data, n, 1) < 0 ? -1 : 0;
+    return n;
+}
+
+static void CloseALSA(AudioSource *source)
+{
+    snd_pcm_close(source->data);
+}
+#endif
+
+/* A multichannel source keeps the channels of the file apart, else they are mixed down */
+AudioSource* OpenWAVSource(const char fileName[], int isPaced, int isMultichannel)
+{
+    FILE *file;
+    AudioSource *source;
+
+    if ( !(file = fopen(fileName, "rb")) )
+        return NULL;
+    if ( !(source = OpenWAVStream(file, fileName, isPaced, isMultichannel)) )
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    ((FileData*)source->data)->ownFile = 1;
+    return source;
+}
+
+/* The stream is only read forward, so that it can be a pipe. A data chunk of size 0 or 0xFFFFFFFF (written
+   before the length was known) goes on until the end of the stream. The file is left open on failure. */
+AudioSource* OpenWAVStream(FILE *file, const char name[], int isPaced, int isMultichannel)
+{
+    FileData *data = NULL;
+    AudioSource *source = NULL;
+    Uint8 header[36];
+    unsigned int chunkSize, format = 0, samplingFreq = 0, bitsPerSample = 0;
+    int found = 0;
+
+    if ( !(data = calloc(1, sizeof(FileData))) )
+        return NULL;
+    data->file = file;
+
+    if (fread(header, 1, 12, data->file) != 12 || memcmp(header, "RIFF", 4) || memcmp(header+8, "WAVE", 4))
+    {
+        FreeFileData(data);
+        return NULL;
+    }
+
+    while (!found && fread(header, 1, 8, data->file) == 8)
+    {
+        chunkSize = ReadLE(header+4, 4);
+        if (!memcmp(header, "fmt ", 4) && chunkSize >= 16)
+        {
+            if (fread(header, 1, 16, data->file) != 16)
+                break;
+            format = ReadLE(header, 2);
+            data->nbChannels = ReadLE(header+2, 2);
+            samplingFreq = ReadLE(header+4, 4);
+            bitsPerSample = ReadLE(header+14, 2);
+            SkipStream(data->file, chunkSize - 16 + (chunkSize & 1));
+        }
+        else if (!memcmp(header, "data", 4))
+        {
+            data->remaining = chunkSize > 0 && chunkSize != 0xFFFFFFFF ? chunkSize : (unsigned int)-1;
+            found = 1;
+        }
+        else SkipStream(data->file, chunkSize + (chunkSize & 1));
+    }
+
+    /* 0xFFFE is WAVE_FORMAT_EXTENSIBLE, whose subformat we assume to be PCM or float according to the size */
+    data->isFloat = format == 3 || (format == 0xFFFE && bitsPerSample == 32);
+    data->sampleSize = bitsPerSample / 8;
+    data->isUnsigned = data->sampleSize == 1;
+    if (!found || !samplingFreq || !data->nbChannels || (format != 1 && format != 3 && format != 0xFFFE)
+        || (data->isFloat ? data->sampleSize != 4 : (data->sampleSize != 1 && data->sampleSize != 2))
+        || !(source = CreateAudioSource(name, samplingFreq,
+                                        data->isFloat ? PCM_FORMAT_FLOAT : (data->sampleSize == 2 ? PCM_FORMAT_PCM16 : PCM_FORMAT_PCM8), data)))
+    {
+        FreeFileData(data);
+        return NULL;
+    }
+
+    data->nbOutChannels = isMultichannel ? data->nbChannels : 1;
+    source->nbChannels = data->nbOutChannels;
+    source->isPaced = isPaced;
+    source->Read = ReadStream;
+    source->Close = CloseStream;
+    return source;
+}
+
+AudioSource* OpenRawSource(FILE *file, unsigned int samplingFreq, int isPaced)
+{
+    FileData *data = NULL;
+    AudioSource *source = NULL;
+
+    if ( !(data = calloc(1, sizeof(FileData))) )
+        return NULL;
+
+    data->file = file;
+    data->nbChannels = 1;
+    data->nbOutChannels = 1;
+    data->sampleSize = 1;
+    data->remaining = (unsigned int)-1;
+    if ( !(source = CreateAudioSource("Raw signed 8-bit stream", samplingFreq, PCM_FORMAT_PCM8, data)) )
+    {
+        free(data);
+        return NULL;
+    }
+
+    source->isPaced = isPaced;
+    source->Read = ReadStream;
+    source->Close = CloseStream;
+    return source;
+}
+
+/* Reads PCM8 (unsigned in WAV files, signed in raw streams), PCM16 or float32 frames and mixes the channels down
+   unless they are kept apart. The samples keep the width they have in the file and are mostly read straight
+   into the buffer. */
+static int ReadStream(AudioSource *source, void *buffer, unsigned int maxLength)
+{
+    FileData *data = source->data;
+    unsigned int frameSize = data->sampleSize * data->nbChannels,
+                 nbFrames, i, j;
+    int isDirect = IsDirectStream(data);
+    size_t nbRead;
+    double value;
+    const Uint8 *frame;
+
+    if (maxLength > sizeof(data->buffer) / frameSize)
+        maxLength = sizeof(data->buffer) / frameSize;
+    if (maxLength > data->remaining / frameSize)
+        maxLength = data->remaining / frameSize;
+    if (!maxLength || !(nbRead = fread(isDirect ? buffer : data->buffer, frameSize, maxLength, data->file)))
+        return -1;
+
+    nbFrames = nbRead;
+    if (data->remaining != (unsigned int)-1)
+        data->remaining -= nbFrames * frameSize;
+    if (isDirect)
+        return nbFrames;
+
+    for (i=0 ; i < nbFrames ; i++)
+    {
+        frame = data->buffer + i*frameSize;
+        if (data->nbOutChannels > 1)
+        {
+            for (j=0 ; j < data->nbChannels ; j++)
+                StoreSample(buffer, i*data->nbChannels + j, source->format, ReadFileSample(data, frame, j));
+        }
+        else
+        {
+            value = 0;
+            for (j=0 ; j < data->nbChannels ; j++)
+                value += ReadFileSample(data, frame, j);
+            StoreSample(buffer, i, source->format, value / data->nbChannels);
+        }
+    }
+
+    return nbFrames;
+}
+
+static void CloseStream(AudioSource *source)
+{
+    FreeFileData(source->data);
+}
+
+/* The sample of the channel, on the scale of its format */
+static double ReadFileSample(const FileData *data, const Uint8 *frame, unsigned int channel)
+{
+    float floatValue;
+
+    if (data->isFloat)
+    {
+        memcpy(&floatValue, frame + channel*4, 4);
+        return floatValue;
+    }
+    else if (data->sampleSize == 2)
+        return (Sint16)ReadLE(frame + channel*2, 2);
+    else if (data->isUnsigned)
+        return (int)frame[channel] - 128;
+    else return (Sint8)frame[channel];
+}
+
+static void FreeFileData(FileData *data)
+{
+    if (data->ownFile)
+        fclose(data->file);
+    free(data);
+}
+
+AudioSource* OpenSyntheticSource(unsigned int samplingFreq, unsigned int snapPeriod_ms, double noiseLevel, unsigned int length_ms, int isPaced)
+{
+    SyntheticData *data = NULL;
+    AudioSource *source = NULL;
+
+    if ( !(data = calloc(1, sizeof(SyntheticData))) )
+        return NULL;
+
+    data->snapPeriod = (Uint64)snapPeriod_ms * samplingFreq / 1000;
+    data->length = length_ms ? (Uint64)length_ms * samplingFreq / 1000 : (unsigned int)-1;
+    data->noiseLevel = noiseLevel;
+    data->seed = 12345;
+    if ( !(source = CreateAudioSource("Synthetic snaps", samplingFreq, PCM_FORMAT_PCM8, data)) )
+    {
+        free(data);
+        return NULL;
+    }
+
+    source->isPaced = isPaced;
+    source->Read = ReadSynthetic;
+    source->Close = CloseSynthetic;
+    return source;
+}
+
+/* White noise, plus every snapPeriod samples a 2-3.5 kHz burst decaying in a few milliseconds, which is
+   roughly what a finger snap looks like to the detector. */
+static int ReadSynthetic(AudioSource *source, void *buffer, unsigned int maxLength)
+{
+    SyntheticData *data = source->data;
+    unsigned int i, t;
+    double value, noise, decay = source->samplingFreq * 0.004;
+
+    if (data->position >= data->length)
+        return -1;
+    if (maxLength > data->length - data->position)
+        maxLength = data->length - data->position;
+
+    for (i=0 ; i < maxLength ; i++, data->position++)
+    {
+        data->seed = data->seed * 1103515245 + 12345;
+        noise = ((data->seed >> 16) & 0x7FFF) / 16383.5 - 1.0;
+        value = data->noiseLevel * 127.0 * noise;
+
+        if (data->snapPeriod > 0 && (t = data->position % data->snapPeriod) < 8*decay)
+            value += 100.0 * exp(-t/decay) * (sin(2*M_PI*2200.0*t/source->samplingFreq)
+                                              + sin(2*M_PI*2700.0*t/source->samplingFreq)
+                                              + sin(2*M_PI*3300.0*t/source->samplingFreq)) / 3;
+
+        StoreSample(buffer, i, source->format, value);
+    }
+
+    return maxLength;
+}
+
+static void CloseSynthetic(AudioSource *source)
+{
+    free(source->data);
+}
+
+void CloseAudioSource(AudioSource *source)
+{
+    if (!source)
+        return;
+
+    StopCapture(source);
+    source->Close(source);
+    FreePCMRing(&source->ring);
+    free(source);
+}
+
+int StartCapture(AudioSource *source, unsigned int ringLength)
+{
+    if (source->thread)
+        return 0;
+
+    FreePCMRing(&source->ring);
+    if (!InitPCMRing(&source->ring, ringLength, GetPCMSampleSize(source->format) * source->nbChannels))
+        return 0;
+
+    source->isEnded = 0;
+    source->nbSamples = 0;
+    source->nbDropped = 0;
+    source->captureTime = SDL_GetTicks();
+    source->stampSequence = 0;
+    source->isCapturing = 1;
+    if ( !(source->thread = SDL_CreateThread(CaptureThread, source)) )
+    {
+        source->isCapturing = 0;
+        return 0;
+    }
+
+    return 1;
+}
+
+void StopCapture(AudioSource *source)
+{
+    if (!source->thread)
+        return;
+
+    AtomicSet(&source->isCapturing, 0);
+    SDL_WaitThread(source->thread, NULL);
+    source->thread = NULL;
+}
+
+/* position counts the samples read from the ring since StartCapture. The samples of one chunk all get
+   the time the chunk was read, so the result is right to within a chunk. */
+Uint32 GetCaptureTime(AudioSource *source, Uint32 position)
+{
+    Uint32 time, nbCommitted, sequence;
+
+    do
+    {
+        while ((sequence = AtomicGet(&source->stampSequence)) & 1)
+            ;
+        time = AtomicGet(&source->captureTime);
+        nbCommitted = AtomicGet(&source->nbSamples) - AtomicGet(&source->nbDropped);
+    } while (sequence != AtomicGet(&source->stampSequence));
+
+    if (position >= nbCommitted)
+        return time;
+    return time - (Uint32)((Uint64)(nbCommitted - position) * 1000 / source->samplingFreq);
+}
+
+static int CaptureThread(void *param)
+{
+    AudioSource *source = param;
+    float dropBuffer[CAPTURE_CHUNKLENGTH];
+    void *buffer;
+    unsigned int space;
+    Uint32 startTime = SDL_GetTicks();
+    int n, delay;
+
+    while (AtomicGet(&source->isCapturing))
+    {
+        if ( !(space = GetPCMRingSpace(&source->ring, &buffer)) )
+        {
+            if (!source->isLive)
+            {
+                SDL_Delay(1);
+                continue;
+            }
+
+            buffer = dropBuffer;
+            space = CAPTURE_CHUNKLENGTH / source->nbChannels;
+        }
+        if (space > CAPTURE_CHUNKLENGTH)
+            space = CAPTURE_CHUNKLENGTH;
+
+        if ((n = source->Read(source, buffer, space)) < 0)
+            break;
+        else if (n == 0)
+        {
+            SDL_Delay(CAPTURE_POLL_MS);
+            continue;
+        }
+
+        AtomicAdd(&source->stampSequence, 1);
+        AtomicSet(&source->captureTime, SDL_GetTicks());
+        if (buffer == dropBuffer)
+            AtomicAdd(&source->nbDropped, n);
+        else CommitPCMRing(&source->ring, n);
+        AtomicAdd(&source->nbSamples, n);
+        AtomicAdd(&source->stampSequence, 1);
+
+        if (source->isPaced)
+        {
+            delay = (int)(startTime + (Uint32)((Uint64)source->nbSamples * 1000 / source->samplingFreq) - SDL_GetTicks());
+            if (delay > 0)
+                SDL_Delay(delay);
+        }
+    }
+
+    AtomicSet(&source->isEnded, 1);
+    return 1;
+}
+
+static AudioSource* CreateAudioSource(const char description[], unsigned int samplingFreq, int format, void *data)
+{
+    AudioSource *source = NULL;
+
+    if ( !(source = calloc(1, sizeof(AudioSource))) )
+        return NULL;
+
+    strncpy(source->description, description, sizeof(source->description) - 1);
+    source->samplingFreq = samplingFreq;
+    source->nbChannels = 1;
+    source->format = format;
+    source->data = data;
+
+    return source;
+}
+
+/* The value is on the scale of the format, rounded and clipped for the integer ones */
+static void StoreSample(void *buffer, unsigned int i, int format, double value)
+{
+    if (format == PCM_FORMAT_FLOAT)
+        ((float*)buffer)[i] = value;
+    else if (format == PCM_FORMAT_PCM16)
+        ((Sint16*)buffer)[i] = value > 32767 ? 32767 : (value < -32768 ? -32768 : (Sint16)floor(value + 0.5));
+    else ((Sint8*)buffer)[i] = value > 127 ? 127 : (value < -128 ? -128 : (Sint8)floor(value + 0.5));
+}
+
+static unsigned int ReadLE(const Uint8 *data, int nbBytes)
+{
+    unsigned int value = 0;
+    int i;
+
+    for (i=nbBytes-1 ; i >= 0 ; i--)
+        value = (value << 8) | data[i];
+
+    return value;
+}
+
+static void SkipStream(FILE *file, unsigned int length)
+{
+    Uint8 buffer[256];
+    size_t n;
+
+    while (length > 0 && (n = fread(buffer, 1, length < sizeof(buffer) ? length : sizeof(buffer), file)) > 0)
+        length -= n;
+}
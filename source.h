@@ -0,0 +1,87 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef SOURCEH
+
+#define SOURCEH
+
+#include <stdio.h>
+#include <SDL.h>
+#ifndef NO_FMOD
+#include <FMOD.h>
+#endif
+#ifdef HAVE_ALSA
+#include <alsa/asoundlib.h>
+#endif
+#include "pcm.h"
+#include "ring.h"
+
+#define CAPTURE_POLL_MS         10
+#define CAPTURE_CHUNKLENGTH     4096
+#define ALSA_LATENCY_US         500000
+
+typedef struct AudioSource AudioSource;
+
+/* A source of samples in its own format (PCM_FORMAT_xxx): they are only converted by the analysis.
+   Sources are mono unless opened as multichannel, then Read gives interleaved frames of nbChannels
+   samples and every length (ring included) counts frames.
+   Read returns the number of samples written to buffer, 0 if none is available yet and -1 at the end of
+   the stream. Streams and ALSA devices wait in Read until maxLength samples are there. Live sources (isLive) cannot wait: when the ring is full their samples are dropped.
+   Other sources are paced to the sampling frequency if isPaced is set, else they are read as fast as
+   the consumer goes.
+   captureTime is the SDL_GetTicks time at which the capture thread got the last samples it put in the
+   ring, GetCaptureTime gives the one of any sample from it. The capture thread makes stampSequence odd
+   while it updates captureTime and the counts, so that they are read together. */
+struct AudioSource
+{
+    char description[50];
+    unsigned int samplingFreq,
+                 nbChannels;
+    int format,
+        isLive,
+        isPaced;
+    int (*Read)(AudioSource *source, void *buffer, unsigned int maxLength);
+    void (*Close)(AudioSource *source);
+    void *data;
+
+    PCMRing ring;
+    SDL_Thread *thread;
+    volatile int isCapturing,
+                 isEnded;
+    volatile Uint32 nbSamples,
+                    nbDropped,
+                    captureTime,
+                    stampSequence;
+};
+
+#ifndef NO_FMOD
+FMOD_SOUND* CreateSoundBuffer(FMOD_SYSTEM *system, unsigned int length, unsigned int samplingFreq, int format);
+AudioSource* OpenFMODSource(FMOD_SYSTEM *system, int driverId, unsigned int samplingFreq, int format, unsigned int bufferLength_PCM);
+#endif
+#ifdef HAVE_ALSA
+AudioSource* OpenALSASource(const char device[], unsigned int samplingFreq, int format);
+#endif
+AudioSource* OpenWAVSource(const char fileName[], int isPaced, int isMultichannel);
+AudioSource* OpenWAVStream(FILE *file, const char name[], int isPaced, int isMultichannel);
+AudioSource* OpenRawSource(FILE *file, unsigned int samplingFreq, int isPaced);
+AudioSource* OpenSyntheticSource(unsigned int samplingFreq, unsigned int snapPeriod_ms, double noiseLevel, unsigned int length_ms, int isPaced);
+void CloseAudioSource(AudioSource *source);
+
+int StartCapture(AudioSource *source, unsigned int ringLength);
+void StopCapture(AudioSource *source);
+Uint32 GetCaptureTime(AudioSource *source, Uint32 position);
+
+#endif
@@ -0,0 +1,339 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "dft.h"
+#include "stft.h"
+
+/* A noise profile is only taken back by an STFT with the same frames */
+typedef struct
+{
+    Uint32 samplingFreq,
+           frameLength,
+           realSize;
+} NoiseProfileHeader;
+
+static void EndFrame(STFT *stft, int isSkipped);
+static void ResumSTFT(STFT *stft);
+
+
+/* hopLength_PCM is the length of the frames if 0 */
+int InitSTFT(STFT *stft, unsigned int samplingFreq, int format, unsigned int windowLength_PCM, unsigned int hopLength_PCM, unsigned int bufferLength_PCM)
+{
+    unsigned int target = samplingFreq * STFT_FRAMELENGTH_MS / 1000,
+                 nbNoiseFrames;
+
+    memset(stft, 0, sizeof(STFT));
+
+    if (hopLength_PCM > 0 && hopLength_PCM*STFT_OVERLAP < target)
+        target = hopLength_PCM*STFT_OVERLAP;
+
+    stft->frameLength = 1;
+    while (stft->frameLength*2 <= target)
+        stft->frameLength *= 2;
+    if (target - stft->frameLength > stft->frameLength*2 - target)
+        stft->frameLength *= 2;
+
+    stft->samplingFreq = samplingFreq;
+    stft->format = format;
+    stft->isGated = 1;
+    stft->sampleSize = GetPCMSampleSize(format);
+    stft->nbBins = stft->frameLength/2 + 1;
+    stft->nbActiveBins = stft->nbBins;
+    stft->hopLength = hopLength_PCM > 0 && hopLength_PCM < stft->frameLength ? hopLength_PCM : stft->frameLength;
+    stft->nbWindowFrames = windowLength_PCM > stft->frameLength ? (windowLength_PCM - stft->frameLength + stft->hopLength/2) / stft->hopLength + 1 : 1;
+    nbNoiseFrames = (bufferLength_PCM + stft->hopLength/2) / stft->hopLength;
+    nbNoiseFrames = nbNoiseFrames > stft->nbWindowFrames ? nbNoiseFrames - stft->nbWindowFrames : 1;
+
+    stft->frameData = malloc(stft->frameLength * stft->sampleSize);
+    stft->excluded = calloc(stft->nbWindowFrames, sizeof(Uint8));
+    stft->isNoise = calloc(stft->nbWindowFrames, sizeof(Uint8));
+    stft->history = calloc(stft->nbWindowFrames * stft->nbBins, sizeof(DFTReal));
+    stft->windowPowers = calloc(stft->nbBins, sizeof(DFTReal));
+    stft->modules = calloc(stft->nbBins, sizeof(DFTReal));
+
+    if (!stft->frameData || !stft->excluded || !stft->isNoise || !stft->history || !stft->windowPowers || !stft->modules
+        || !InitNoiseModel(&stft->noise, stft->nbBins, nbNoiseFrames, stft->nbWindowFrames, (double)nbNoiseFrames * stft->hopLength / stft->frameLength))
+    {
+        FreeSTFT(stft);
+        return 0;
+    }
+
+    InitTransientGate(&stft->gate);
+    ReleaseDFTPlan(AcquireDFTPlan(stft->frameLength));
+    return 1;
+}
+
+void FreeSTFT(STFT *stft)
+{
+    free(stft->frameData);
+    free(stft->excluded);
+    free(stft->isNoise);
+    free(stft->history);
+    free(stft->windowPowers);
+    free(stft->modules);
+    FreeNoiseModel(&stft->noise);
+    memset(stft, 0, sizeof(STFT));
+}
+
+int FeedSTFT(STFT *stft, const void *pcmData, unsigned int length)
+{
+    DFTPlan *dftPlan = NULL;
+    const Uint8 *data = pcmData,
+                *frame;
+    unsigned int n;
+    int nbNewFrames = 0;
+
+    while (length > 0)
+    {
+        n = stft->frameLength - stft->framePos;
+        if (n > length)
+            n = length;
+
+        if (stft->framePos == 0 && n == stft->frameLength)
+            frame = data;
+        else
+        {
+            memcpy(stft->frameData + stft->framePos*stft->sampleSize, data, n*stft->sampleSize);
+            frame = stft->frameData;
+        }
+        stft->framePos += n;
+        data += n*stft->sampleSize;
+        length -= n;
+
+        if (stft->framePos == stft->frameLength)
+        {
+            if (IsSTFTFrameSkipped(stft, UpdateTransientGate(&stft->gate, frame, stft->frameLength, stft->format, 1)))
+                SkipSTFTFrame(stft);
+            else
+            {
+                if (!dftPlan && !(dftPlan = AcquireDFTPlan(stft->frameLength)))
+                    return nbNewFrames;
+
+                ProcessDFTPower(dftPlan, frame, stft->frameLength, stft->format, NextSTFTFrame(stft), stft->nbActiveBins);
+                CommitSTFTFrame(stft);
+            }
+
+            stft->framePos = ShiftSTFTFrame(stft, stft->frameData, frame, stft->sampleSize);
+            nbNewFrames++;
+        }
+    }
+
+    ReleaseDFTPlan(dftPlan);
+    return nbNewFrames;
+}
+
+/* The samples which the next frame shares with frame are moved to the start of frameData, their number
+   is returned. frameSize is the size of one sample of all the channels. */
+unsigned int ShiftSTFTFrame(const STFT *stft, Uint8 *frameData, const Uint8 *frame, unsigned int frameSize)
+{
+    unsigned int n = stft->frameLength - stft->hopLength;
+
+    if (n > 0)
+        memmove(frameData, frame + stft->hopLength*frameSize, n*frameSize);
+    return n;
+}
+
+/* Bins which were not computed until now start empty: they are only right again once a whole window
+   has gone through */
+void SetSTFTActiveBins(STFT *stft, unsigned int nbActiveBins)
+{
+    unsigned int j, from = stft->nbActiveBins;
+
+    if (nbActiveBins < 1 || nbActiveBins > stft->nbBins)
+        nbActiveBins = stft->nbBins;
+    stft->nbActiveBins = nbActiveBins;
+    if (nbActiveBins <= from)
+        return;
+
+    for (j=0 ; j < stft->nbWindowFrames ; j++)
+        memset(stft->history + j*stft->nbBins + from, 0, sizeof(DFTReal) * (nbActiveBins-from));
+    memset(stft->windowPowers + from, 0, sizeof(DFTReal) * (nbActiveBins-from));
+    memset(stft->modules + from, 0, sizeof(DFTReal) * (nbActiveBins-from));
+    memset(stft->noise.powers + from, 0, sizeof(DFTReal) * (nbActiveBins-from));
+}
+
+/* The noise is subtracted from the magnitudes, bins which are under the noise floor are compared on
+   their powers and do not need any square root */
+void GetSTFTSpectra(STFT *stft, int subtractNoise)
+{
+    unsigned int i;
+    DFTReal power, noisePower,
+            scale = stft->noise.scale,
+            overlap = (DFTReal)stft->hopLength / stft->frameLength;
+
+    for (i=0 ; i < stft->nbActiveBins ; i++)
+    {
+        power = overlap * stft->windowPowers[i];
+        if (!subtractNoise)
+            stft->modules[i] = power > 0 ? DFTSqrt(power) : 0;
+        else if (power > (noisePower = scale * stft->noise.powers[i]))
+            stft->modules[i] = DFTSqrt(power) - DFTSqrt(noisePower);
+        else stft->modules[i] = 0;
+    }
+}
+
+void ExcludeSTFTWindow(STFT *stft)
+{
+    memset(stft->excluded, 1, stft->nbWindowFrames);
+}
+
+DFTReal* NextSTFTFrame(STFT *stft)
+{
+    unsigned int i,
+                 slot = stft->nbFrames % stft->nbWindowFrames;
+    DFTReal *frame = stft->history + slot*stft->nbBins;
+
+    /* The slot holds the frame which is leaving the window */
+    if (stft->nbFrames >= stft->nbWindowFrames)
+    {
+        for (i=0 ; i < stft->nbActiveBins ; i++)
+            stft->windowPowers[i] -= frame[i];
+        if (!stft->excluded[slot] && stft->isNoise[slot])
+            UpdateNoiseModel(&stft->noise, frame, stft->nbActiveBins);
+    }
+
+    return frame;
+}
+
+void CommitSTFTFrame(STFT *stft)
+{
+    EndFrame(stft, 0);
+}
+
+void SkipSTFTFrame(STFT *stft)
+{
+    memcpy(NextSTFTFrame(stft), stft->noise.powers, sizeof(DFTReal) * stft->nbActiveBins);
+    EndFrame(stft, 1);
+}
+
+/* Also records where the last onset was. gateState is what UpdateTransientGate returned for the frame.
+   Once the noise model has settled, a refresh frame is only needed about once per time constant. */
+int IsSTFTFrameSkipped(STFT *stft, int gateState)
+{
+    stft->gate.refreshFrames = IsNoiseModelSettled(&stft->noise) && stft->noise.timeConstant > GATE_REFRESHFRAMES ?
+                               stft->noise.timeConstant : GATE_REFRESHFRAMES;
+
+    if (gateState == GATE_OPEN && stft->gateState != GATE_OPEN)
+        stft->onsetFrame = stft->nbFrames;
+    stft->gateState = gateState;
+    if (gateState == GATE_OPEN)
+        stft->lastOpenFrame = stft->nbFrames + 1;
+
+    return stft->isGated && gateState == GATE_CLOSED && IsNoiseModelReady(&stft->noise);
+}
+
+int IsSTFTWindowQuiet(STFT *stft)
+{
+    return stft->isGated && IsNoiseModelReady(&stft->noise) && stft->nbFrames - stft->lastOpenFrame >= stft->nbWindowFrames;
+}
+
+/* Sample where the last onset of the window starts, or where the window starts if it has none */
+Uint32 GetSTFTOnset(const STFT *stft)
+{
+    if (stft->lastOpenFrame > 0 && stft->nbFrames - stft->onsetFrame <= stft->nbWindowFrames)
+        return stft->onsetFrame * stft->hopLength;
+    else if (stft->nbFrames > stft->nbWindowFrames)
+        return (stft->nbFrames - stft->nbWindowFrames) * stft->hopLength;
+    else return 0;
+}
+
+/* Nothing is saved before the noise model is ready */
+int SaveSTFTNoise(const STFT *stft, const char fileName[])
+{
+    FILE *noiseFile;
+    NoiseProfileHeader header;
+    int result;
+
+    if (!IsNoiseModelReady(&stft->noise))
+        return 0;
+
+    header.samplingFreq = stft->samplingFreq;
+    header.frameLength = stft->frameLength;
+    header.realSize = sizeof(DFTReal);
+
+    if ( !(noiseFile = fopen(fileName, "wb")) )
+        return 0;
+
+    result = fwrite(&header, sizeof(NoiseProfileHeader), 1, noiseFile) == 1
+             && fwrite(stft->noise.powers, sizeof(DFTReal), stft->nbBins, noiseFile) == stft->nbBins;
+    fclose(noiseFile);
+    return result;
+}
+
+/* Returns 0, and the noise model is learnt from scratch, if the file is missing or was saved for
+   other frames */
+int LoadSTFTNoise(STFT *stft, const char fileName[])
+{
+    FILE *noiseFile;
+    NoiseProfileHeader header;
+    DFTReal *powers;
+    int result = 0;
+
+    if ( !(noiseFile = fopen(fileName, "rb")) )
+        return 0;
+
+    if (fread(&header, sizeof(NoiseProfileHeader), 1, noiseFile) == 1
+        && header.samplingFreq == stft->samplingFreq && header.frameLength == stft->frameLength && header.realSize == sizeof(DFTReal)
+        && (powers = malloc(sizeof(DFTReal) * stft->nbBins)))
+    {
+        if (fread(powers, sizeof(DFTReal), stft->nbBins, noiseFile) == stft->nbBins)
+        {
+            RestoreNoiseModel(&stft->noise, powers);
+            result = 1;
+        }
+        free(powers);
+    }
+
+    fclose(noiseFile);
+    return result;
+}
+
+static void EndFrame(STFT *stft, int isSkipped)
+{
+    unsigned int i,
+                 slot = stft->nbFrames % stft->nbWindowFrames;
+    DFTReal *frame = stft->history + slot*stft->nbBins;
+
+    stft->excluded[slot] = 0;
+    stft->isNoise[slot] = !isSkipped && !(stft->isGated && stft->gateState == GATE_OPEN);
+    for (i=0 ; i < stft->nbActiveBins ; i++)
+        stft->windowPowers[i] += frame[i];
+
+    stft->nbFrames++;
+
+    /* The running sum slowly drifts because of rounding, rebuild it once per window length */
+    if (stft->nbFrames % stft->nbWindowFrames == 0)
+        ResumSTFT(stft);
+}
+
+static void ResumSTFT(STFT *stft)
+{
+    unsigned int i, j;
+    DFTReal *frame;
+
+    memset(stft->windowPowers, 0, sizeof(DFTReal) * stft->nbActiveBins);
+
+    for (j=0 ; j < stft->nbWindowFrames && j < stft->nbFrames ; j++)
+    {
+        frame = stft->history + j*stft->nbBins;
+        for (i=0 ; i < stft->nbActiveBins ; i++)
+            stft->windowPowers[i] += frame[i];
+    }
+}
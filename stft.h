@@ -0,0 +1,98 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef STFTH
+
+#define STFTH
+
+#include <SDL.h>
+#include "dft.h"
+#include "noise.h"
+#include "pcm.h"
+#include "gate.h"
+
+#define STFT_FRAMELENGTH_MS     20
+#define STFT_OVERLAP            2
+#define STFT_MINHOP_MS          5
+
+/* Streaming short-time Fourier transform.
+   The recorded sound is cut into frames of frameLength samples and each frame is transformed once.
+   The spectrum of the analysis window (last nbWindowFrames frames) is kept as a running sum of frame
+   powers, so the cost of a tick only depends on the number of new samples. Summing frame powers gives
+   the same expected magnitudes as one long zero-padded transform.
+   Frames leaving the window feed the noise model, unless they were excluded because they were part
+   of a detected snap.
+   Only the first nbActiveBins bins are computed: the detection does not look above its last band,
+   the whole spectrum is only worth computing while it is displayed.
+   Samples are kept in their own format: a frame given whole is transformed where it is, only the frames
+   cut between two calls are put together in frameData.
+   A new frame starts every hopLength samples. With a hop shorter than the frames, they overlap and the
+   frames are shortened along with the hop (down to STFT_OVERLAP hops), so that the transforms and the
+   bins to go through per second stay about the same as the hop shrinks. The window powers are scaled
+   back to those of frames which do not overlap.
+   Frames transformed elsewhere (several channels at once) are added with NextSTFTFrame, which gives
+   the slot to fill with the frame powers, then CommitSTFTFrame.
+   While isGated is set and the noise model is ready, the frames the transient gate keeps closed are not
+   transformed: they stand in the window as the noise floor (SkipSTFTFrame). Neither they nor the onsets
+   feed the noise model, which learns from the periodic refresh frames: one every GATE_REFRESHFRAMES
+   until it has settled, then one per noise time constant, so that a quiet room costs next to no
+   transforms. A window which has seen no onset (IsSTFTWindowQuiet) is not worth analysing either.
+   The gate runs even when the frames are not skipped, to locate the onsets (GetSTFTOnset).
+   The noise floor can be saved when the analysis stops (SaveSTFTNoise) and given back to the next
+   one (LoadSTFTNoise), which then subtracts the noise from its first frame on. */
+typedef struct
+{
+    unsigned int samplingFreq,
+                 sampleSize,
+                 frameLength,
+                 hopLength,
+                 nbBins,
+                 nbActiveBins,
+                 nbWindowFrames,
+                 framePos;
+    int format,
+        isGated,
+        gateState;
+    Uint32 nbFrames,
+           lastOpenFrame,
+           onsetFrame;
+    Uint8 *frameData;
+    Uint8 *excluded,
+          *isNoise;
+    DFTReal *history,
+            *windowPowers,
+            *modules;
+    NoiseModel noise;
+    TransientGate gate;
+} STFT;
+
+int InitSTFT(STFT *stft, unsigned int samplingFreq, int format, unsigned int windowLength_PCM, unsigned int hopLength_PCM, unsigned int bufferLength_PCM);
+void FreeSTFT(STFT *stft);
+int FeedSTFT(STFT *stft, const void *pcmData, unsigned int length);
+unsigned int ShiftSTFTFrame(const STFT *stft, Uint8 *frameData, const Uint8 *frame, unsigned int frameSize);
+void SetSTFTActiveBins(STFT *stft, unsigned int nbActiveBins);
+void GetSTFTSpectra(STFT *stft, int subtractNoise);
+void ExcludeSTFTWindow(STFT *stft);
+DFTReal* NextSTFTFrame(STFT *stft);
+void CommitSTFTFrame(STFT *stft);
+void SkipSTFTFrame(STFT *stft);
+int IsSTFTFrameSkipped(STFT *stft, int gateState);
+int IsSTFTWindowQuiet(STFT *stft);
+Uint32 GetSTFTOnset(const STFT *stft);
+int SaveSTFTNoise(const STFT *stft, const char fileName[]);
+int LoadSTFTNoise(STFT *stft, const char fileName[]);
+
+#endif
@@ -0,0 +1,90 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <string.h>
+#include "atomics.h"
+#include "worker.h"
+
+static int WorkerThread(void *param);
+
+
+int StartWorker(Worker *worker, int (*function)(void *param), void *param, unsigned int maxBacklog)
+{
+    memset(worker, 0, sizeof(Worker));
+    worker->function = function;
+    worker->param = param;
+    worker->maxBacklog = maxBacklog > 0 ? maxBacklog : 1;
+    worker->isRunning = 1;
+
+    if ( !(worker->semaphore = SDL_CreateSemaphore(0)) )
+        return 0;
+    if ( !(worker->thread = SDL_CreateThread(WorkerThread, worker)) )
+    {
+        SDL_DestroySemaphore(worker->semaphore);
+        worker->semaphore = NULL;
+        return 0;
+    }
+
+    return 1;
+}
+
+int PostWorkerTick(Worker *worker)
+{
+    if (!AtomicGet(&worker->isRunning))
+        return 0;
+
+    if (AtomicAdd(&worker->nbPending, 1) > worker->maxBacklog)
+    {
+        AtomicAdd(&worker->nbPending, -1);
+        AtomicAdd(&worker->nbDropped, 1);
+        return 0;
+    }
+
+    SDL_SemPost(worker->semaphore);
+    return 1;
+}
+
+void StopWorker(Worker *worker)
+{
+    if (!worker->thread)
+        return;
+
+    AtomicSet(&worker->isRunning, 0);
+    SDL_SemPost(worker->semaphore);
+    SDL_WaitThread(worker->thread, NULL);
+    SDL_DestroySemaphore(worker->semaphore);
+
+    worker->thread = NULL;
+    worker->semaphore = NULL;
+}
+
+static int WorkerThread(void *param)
+{
+    Worker *worker = param;
+
+    while (1)
+    {
+        SDL_SemWait(worker->semaphore);
+        if (!AtomicGet(&worker->isRunning))
+            break;
+
+        AtomicAdd(&worker->nbPending, -1);
+        AtomicAdd(&worker->nbTicks, 1);
+        worker->function(worker->param);
+    }
+
+    return 1;
+}
@@ -0,0 +1,43 @@
+/**** LICENSE INFORMATION ****
+Snap Detector
+Snap finger detection freeware
+Copyright (C) 2013  Quoc-Nam Dessoulles
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef WORKERH
+
+#define WORKERH
+
+#include <SDL.h>
+
+/* Long-lived thread running function(param) once per posted tick.
+   At most maxBacklog ticks can be pending, further ticks are dropped (and counted): the analysis
+   consumes everything recorded since its last run, so a dropped tick loses no sound. */
+typedef struct
+{
+    int (*function)(void *param);
+    void *param;
+    unsigned int maxBacklog;
+    SDL_Thread *thread;
+    SDL_sem *semaphore;
+    volatile int isRunning;
+    volatile Uint32 nbPending,
+                    nbTicks,
+                    nbDropped;
+} Worker;
+
+int StartWorker(Worker *worker, int (*function)(void *param), void *param, unsigned int maxBacklog);
+int PostWorkerTick(Worker *worker);
+void StopWorker(Worker *worker);
+
+#endif